@@ -0,0 +1,723 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <RobotMap.h>
+#include <RobotPlanner.h>
+#include <RobotMovingAI.h>
+#include "RobotBenchmark.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#include <sys/resource.h>
+#else
+#include <malloc.h>
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+// Every heap allocation of the process goes through here so the benchmark can count them.
+// The bytes in use are followed with the size the allocator reports for each block, which
+// may be a little more than was asked for. The replacements are kept out of line: inlined
+// into a caller, a free() would look to the compiler like it releases a new'ed pointer.
+#ifdef _MSC_VER
+#define BENCHMARK_NOINLINE __declspec(noinline)
+#else
+#define BENCHMARK_NOINLINE __attribute__((noinline))
+#endif
+
+namespace
+{
+    std::atomic<size_t> allocationCount(0);
+    std::atomic<size_t> allocatedBytes(0);
+    std::atomic<size_t> liveBytes(0);
+    std::atomic<size_t> peakLiveBytes(0);
+
+    size_t blockSize(void* block) {
+#ifdef _WIN32
+        return _msize(block);
+#elif defined(__APPLE__)
+        return malloc_size(block);
+#else
+        return malloc_usable_size(block);
+#endif
+    }
+}
+
+BENCHMARK_NOINLINE void* operator new(size_t size) {
+    void* block = std::malloc(size > 0 ? size : 1);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    const size_t held = blockSize(block);
+    const size_t live = liveBytes.fetch_add(held, std::memory_order_relaxed) + held;
+    size_t peak = peakLiveBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    return block;
+}
+
+BENCHMARK_NOINLINE void operator delete(void* pointer) noexcept {
+    if (pointer == nullptr) {
+        return;
+    }
+    liveBytes.fetch_sub(blockSize(pointer), std::memory_order_relaxed);
+    std::free(pointer);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* pointer) noexcept { operator delete(pointer); }
+void operator delete(void* pointer, size_t) noexcept { operator delete(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { operator delete(pointer); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    }
+    catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { operator delete(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { operator delete(pointer); }
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    double millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    size_t peakResidentKilobytes() {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return 0;
+        }
+        return counters.PeakWorkingSetSize / 1024;
+#else
+        rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) {
+            return 0;
+        }
+#ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss) / 1024;
+#else
+        return static_cast<size_t>(usage.ru_maxrss);
+#endif
+#endif
+    }
+
+    const char* engineName(RPP::SearchEngine engine) {
+        switch (engine) {
+        case RPP::SearchEngine::JumpPoint: return "jps";
+        case RPP::SearchEngine::Bidirectional: return "bidirectional";
+        case RPP::SearchEngine::Anytime: return "anytime";
+        default: return "astar";
+        }
+    }
+
+    const char* heuristicName(RPP::HeuristicMode mode) {
+        switch (mode) {
+        case RPP::HeuristicMode::Dijkstra: return "dijkstra";
+        case RPP::HeuristicMode::Euclidean: return "euclidean";
+        case RPP::HeuristicMode::None: return "none";
+        default: return "octile";
+        }
+    }
+
+    // Random circles until about density of the map is covered. Overlaps make the measured
+    // density come out somewhat lower, it is reported alongside.
+    void buildCircles(RPP::Map& map, double density, std::mt19937& rng) {
+        const int maxRadius = std::max(3, std::min(map.getNumRows(), map.getNumCols()) / 50);
+        double meanArea = 0.0;
+        for (int radius = 1; radius <= maxRadius; ++radius) {
+            meanArea += 3.14159265358979 * radius * radius / maxRadius;
+        }
+        const int count = static_cast<int>(density * map.getNumCells() / meanArea);
+        for (int i = 0; i < count; ++i) {
+            const int row = static_cast<int>(rng() % map.getNumRows());
+            const int col = static_cast<int>(rng() % map.getNumCols());
+            map.createObstacle(row, col, 1 + static_cast<int>(rng() % maxRadius));
+        }
+        map.addObstaclesToMap(map.getObstaclesList());
+    }
+
+    // Perfect maze carved by a depth first walk. Corridors leave the robot a cell to spare on
+    // either side and walls are two cells thick, so every pair of corridor cells is connected
+    // and paths wind through most of the map.
+    void buildMaze(RPP::Map& map, int radius, std::mt19937& rng) {
+        const int corridor = 2 * std::max(radius, 0) + 3;
+        const int wall = 2;
+        const int pitch = corridor + wall;
+        const int cellRows = (map.getNumRows() - wall) / pitch;
+        const int cellCols = (map.getNumCols() - wall) / pitch;
+
+        for (int cell = 0; cell < map.getNumCells(); ++cell) {
+            map.setObstacle(cell, true);
+        }
+        auto carve = [&map](int firstRow, int firstCol, int rows, int cols) {
+            for (int row = firstRow; row < firstRow + rows; ++row) {
+                for (int col = firstCol; col < firstCol + cols; ++col) {
+                    map.setObstacle(map.getIndex(row, col), false);
+                }
+            }
+        };
+
+        if (cellRows > 0 && cellCols > 0) {
+            const int rowStep[4] = { -1, 1, 0, 0 };
+            const int colStep[4] = { 0, 0, -1, 1 };
+            std::vector<char> visited(static_cast<size_t>(cellRows) * cellCols, 0);
+            std::vector<int> stack(1, 0);
+            visited[0] = 1;
+            carve(wall, wall, corridor, corridor);
+            while (!stack.empty()) {
+                const int row = stack.back() / cellCols;
+                const int col = stack.back() % cellCols;
+                int options[4];
+                int count = 0;
+                for (int direction = 0; direction < 4; ++direction) {
+                    const int nextRow = row + rowStep[direction];
+                    const int nextCol = col + colStep[direction];
+                    if (nextRow >= 0 && nextCol >= 0 && nextRow < cellRows && nextCol < cellCols && !visited[nextRow * cellCols + nextCol]) {
+                        options[count++] = direction;
+                    }
+                }
+                if (count == 0) {
+                    stack.pop_back();
+                    continue;
+                }
+                // Knock down the wall to the next cell along with the cell itself
+                const int direction = options[rng() % count];
+                const int nextRow = row + rowStep[direction];
+                const int nextCol = col + colStep[direction];
+                carve(wall + std::min(row, nextRow) * pitch, wall + std::min(col, nextCol) * pitch,
+                    rowStep[direction] != 0 ? pitch + corridor : corridor, colStep[direction] != 0 ? pitch + corridor : corridor);
+                visited[nextRow * cellCols + nextCol] = 1;
+                stack.push_back(nextRow * cellCols + nextCol);
+            }
+        }
+
+        // Occupancy was written directly, this only computes the clearance
+        map.addObstaclesToMap(std::vector<RPP::Obstacle>());
+    }
+
+    // Start and goal pairs the robot fits on, at least a quarter of the map apart
+    std::vector<std::pair<RPP::Node, RPP::Node>> pickQueries(const RPP::Map& map, int radius, int count, std::mt19937& rng) {
+        std::vector<std::pair<RPP::Node, RPP::Node>> queries;
+        const int minimumGap = (map.getNumRows() + map.getNumCols()) / 4;
+        for (int attempt = 0; attempt < count * 10000 && static_cast<int>(queries.size()) < count; ++attempt) {
+            const int start = static_cast<int>(rng() % map.getNumCells());
+            const int goal = static_cast<int>(rng() % map.getNumCells());
+            if (!map.robotFits(start, radius) || !map.robotFits(goal, radius)) {
+                continue;
+            }
+            if (std::abs(map.getRow(start) - map.getRow(goal)) + std::abs(map.getCol(start) - map.getCol(goal)) < minimumGap) {
+                continue;
+            }
+            queries.push_back(std::make_pair(map.getNode(start), map.getNode(goal)));
+        }
+        return queries;
+    }
+
+    std::string csvField(const std::string& value) {
+        if (value.find_first_of(",\"\n") == std::string::npos) {
+            return value;
+        }
+        std::string quoted = "\"";
+        for (char c : value) {
+            quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+        }
+        return quoted + "\"";
+    }
+
+    std::string jsonString(const std::string& value) {
+        std::string quoted = "\"";
+        for (char c : value) {
+            if (c == '"' || c == '\\') {
+                quoted += '\\';
+            }
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    void writeHeader(std::ostream& os) {
+        os << "generator,map,rows,cols,density,radius,engine,heuristic,queries,found,"
+            "map_ms,obstacles_ms,inflation_ms,heuristic_ms,search_ms,path_ms,expansions,generated,decrease_keys,peak_open,"
+            "ns_per_expansion,expansions_per_sec,"
+            "setup_allocations,search_allocations,search_allocated_bytes,peak_heap_bytes,peak_rss_kb\n";
+    }
+
+    void writeRecord(std::ostream& os, const BenchmarkRecord& record, bool json) {
+        if (json) {
+            os << "{\"generator\":" << jsonString(record.generator) << ",\"map\":" << jsonString(record.map)
+                << ",\"rows\":" << record.rows << ",\"cols\":" << record.cols << ",\"density\":" << record.density
+                << ",\"radius\":" << record.radius << ",\"engine\":" << jsonString(record.engine) << ",\"heuristic\":" << jsonString(record.heuristic)
+                << ",\"queries\":" << record.queries << ",\"found\":" << record.found
+                << ",\"map_ms\":" << record.mapMilliseconds << ",\"obstacles_ms\":" << record.obstaclesMilliseconds
+                << ",\"inflation_ms\":" << record.inflationMilliseconds << ",\"heuristic_ms\":" << record.heuristicMilliseconds
+                << ",\"search_ms\":" << record.searchMilliseconds << ",\"path_ms\":" << record.pathMilliseconds << ",\"expansions\":" << record.expansions
+                << ",\"generated\":" << record.generated << ",\"decrease_keys\":" << record.decreaseKeys << ",\"peak_open\":" << record.peakOpenSize
+                << ",\"ns_per_expansion\":" << record.nanosecondsPerExpansion << ",\"expansions_per_sec\":" << record.expansionsPerSecond
+                << ",\"setup_allocations\":" << record.setupAllocations << ",\"search_allocations\":" << record.searchAllocations
+                << ",\"search_allocated_bytes\":" << record.searchAllocatedBytes << ",\"peak_heap_bytes\":" << record.peakHeapBytes
+                << ",\"peak_rss_kb\":" << record.peakResidentKilobytes << "}\n";
+        }
+        else {
+            os << csvField(record.generator) << ',' << csvField(record.map) << ',' << record.rows << ',' << record.cols << ','
+                << record.density << ',' << record.radius << ',' << record.engine << ',' << record.heuristic << ','
+                << record.queries << ',' << record.found << ',' << record.mapMilliseconds << ',' << record.obstaclesMilliseconds << ','
+                << record.inflationMilliseconds << ',' << record.heuristicMilliseconds << ',' << record.searchMilliseconds << ','
+                << record.pathMilliseconds << ',' << record.expansions << ',' << record.generated << ',' << record.decreaseKeys << ','
+                << record.peakOpenSize << ',' << record.nanosecondsPerExpansion << ',' << record.expansionsPerSecond << ','
+                << record.setupAllocations << ',' << record.searchAllocations << ',' << record.searchAllocatedBytes << ','
+                << record.peakHeapBytes << ',' << record.peakResidentKilobytes << '\n';
+        }
+        os.flush();
+    }
+
+    // Times the queries on a finished map once per engine. setup carries the map phases,
+    // which are shared by all the engines.
+    void runQueries(const RPP::Map& map, const BenchmarkRecord& setup, const BenchmarkOptions& options, std::mt19937& rng, std::ostream& os) {
+
+        size_t obstacleCells = 0;
+        for (int cell = 0; cell < map.getNumCells(); ++cell) {
+            obstacleCells += map.isObstacle(cell) ? 1 : 0;
+        }
+
+        Clock::time_point start = Clock::now();
+        map.getTraversable(setup.radius);
+        const double inflationMilliseconds = millisecondsSince(start);
+
+        const std::vector<std::pair<RPP::Node, RPP::Node>> queries = pickQueries(map, setup.radius, options.queries, rng);
+        for (RPP::SearchEngine engine : options.engines) {
+            BenchmarkRecord record = setup;
+            record.density = static_cast<double>(obstacleCells) / map.getNumCells();
+            record.engine = engineName(engine);
+            record.heuristic = heuristicName(options.heuristicMode);
+            record.inflationMilliseconds = inflationMilliseconds;
+            record.queries = static_cast<int>(queries.size());
+            record.found = 0;
+            record.heuristicMilliseconds = 0.0;
+            record.searchMilliseconds = 0.0;
+            record.pathMilliseconds = 0.0;
+            record.expansions = 0;
+            record.generated = 0;
+            record.decreaseKeys = 0;
+            record.peakOpenSize = 0;
+
+            RPP::PlanParams params;
+            params.robotRadius = setup.radius;
+            params.heuristicMode = options.heuristicMode;
+            params.engine = engine;
+            params.weight = options.weight;
+
+            // One untimed query sizes the search buffers, the timed ones then show the steady state
+            RPP::Planner planner(map);
+            if (!queries.empty()) {
+                planner.plan(queries[0].first, queries[0].second, params);
+            }
+
+            const size_t allocations = allocationCount.load();
+            const size_t bytes = allocatedBytes.load();
+            for (const std::pair<RPP::Node, RPP::Node>& query : queries) {
+                const RPP::PlanResult result = planner.plan(query.first, query.second, params);
+                record.found += result.found() ? 1 : 0;
+                record.heuristicMilliseconds += result.heuristicMilliseconds;
+                record.searchMilliseconds += result.stats.searchMilliseconds;
+                record.pathMilliseconds += result.stats.pathMilliseconds;
+                record.expansions += result.expansions;
+                record.generated += result.stats.generated;
+                record.decreaseKeys += result.stats.decreaseKeys;
+                record.peakOpenSize = std::max(record.peakOpenSize, result.stats.peakOpenSize);
+            }
+            record.searchAllocations = allocationCount.load() - allocations;
+            record.searchAllocatedBytes = allocatedBytes.load() - bytes;
+
+            record.nanosecondsPerExpansion = record.expansions > 0 ? record.searchMilliseconds * 1e6 / record.expansions : 0.0;
+            record.expansionsPerSecond = record.searchMilliseconds > 0.0 ? record.expansions * 1000.0 / record.searchMilliseconds : 0.0;
+            record.peakHeapBytes = peakLiveBytes.load();
+            record.peakResidentKilobytes = peakResidentKilobytes();
+            writeRecord(os, record, options.json);
+        }
+    }
+
+    BenchmarkRecord beginScenario(const std::string& generator, int radius) {
+        peakLiveBytes.store(liveBytes.load());
+        BenchmarkRecord record = BenchmarkRecord();
+        record.generator = generator;
+        record.radius = radius;
+        return record;
+    }
+
+    // Builds a synthetic map, timing construction and obstacles into the record
+    std::unique_ptr<RPP::Map> buildMap(BenchmarkRecord& setup, int size, double density, std::mt19937& rng) {
+        setup.rows = size;
+        setup.cols = size;
+        const size_t allocations = allocationCount.load();
+        Clock::time_point start = Clock::now();
+        std::unique_ptr<RPP::Map> map(new RPP::Map(size, size));
+        setup.mapMilliseconds = millisecondsSince(start);
+        start = Clock::now();
+        if (setup.generator == "maze") {
+            buildMaze(*map, setup.radius, rng);
+        }
+        else {
+            buildCircles(*map, density, rng);
+        }
+        setup.obstaclesMilliseconds = millisecondsSince(start);
+        setup.setupAllocations = allocationCount.load() - allocations;
+        return map;
+    }
+
+    void runSynthetic(const BenchmarkOptions& options, std::ostream& os) {
+        std::mt19937 rng(options.seed);
+        for (int size : options.sizes) {
+            for (const std::string& generator : options.generators) {
+                if (generator == "maze") {
+                    // Mazes are cut to the robot, one per radius
+                    for (int radius : options.radii) {
+                        BenchmarkRecord setup = beginScenario(generator, radius);
+                        std::unique_ptr<RPP::Map> map = buildMap(setup, size, 0.0, rng);
+                        runQueries(*map, setup, options, rng, os);
+                    }
+                    continue;
+                }
+                // Circle maps serve every radius
+                for (double density : options.densities) {
+                    BenchmarkRecord setup = beginScenario(generator, 0);
+                    std::unique_ptr<RPP::Map> map = buildMap(setup, size, density, rng);
+                    for (int radius : options.radii) {
+                        setup.radius = radius;
+                        runQueries(*map, setup, options, rng, os);
+                    }
+                }
+            }
+        }
+    }
+
+    void runRecorded(const BenchmarkOptions& options, std::ostream& os) {
+        std::mt19937 rng(options.seed);
+        for (std::string filename : options.mapFiles) {
+            BenchmarkRecord setup = beginScenario("file", 0);
+            setup.map = filename;
+
+            const size_t allocations = allocationCount.load();
+            Clock::time_point start = Clock::now();
+            RPP::Map map;
+            map.loadFromFile(filename);
+            setup.mapMilliseconds = millisecondsSince(start);
+            setup.setupAllocations = allocationCount.load() - allocations;
+            setup.rows = map.getNumRows();
+            setup.cols = map.getNumCols();
+
+            for (int radius : options.radii) {
+                setup.radius = radius;
+                runQueries(map, setup, options, rng, os);
+            }
+        }
+    }
+
+    // Scenario files name their map relative to the benchmark root, try it as written and by file name alone
+    std::string findScenarioMap(const std::string& scenarioFile, const std::string& mapName, const std::string& mapDirectory) {
+        std::string directory = mapDirectory;
+        if (directory.empty()) {
+            const size_t slash = scenarioFile.find_last_of("/\\");
+            directory = slash == std::string::npos ? "." : scenarioFile.substr(0, slash);
+        }
+        const size_t slash = mapName.find_last_of("/\\");
+        const std::string candidates[2] = { directory + "/" + mapName, directory + "/" + mapName.substr(slash == std::string::npos ? 0 : slash + 1) };
+        for (const std::string& candidate : candidates) {
+            if (std::ifstream(candidate).is_open()) {
+                return candidate;
+            }
+        }
+        throw std::runtime_error("Map " + mapName + " of " + scenarioFile + " not found in " + directory);
+    }
+
+    void writeScenarioHeader(std::ostream& os) {
+        os << "map,engine,heuristic,bucket,scenarios,optimal,cuts_corner,within_bound,suboptimal,mismatch,no_path,worst_ratio,"
+            "expansions,heuristic_ms,search_ms,us_per_query,ns_per_expansion\n";
+    }
+
+    void writeScenarioBucket(std::ostream& os, const std::string& map, RPP::SearchEngine engine, RPP::HeuristicMode heuristic,
+        const RPP::ScenarioBucket& bucket, bool json) {
+        const double microsecondsPerQuery = bucket.scenarios > 0 ? (bucket.heuristicMilliseconds + bucket.searchMilliseconds) * 1000.0 / bucket.scenarios : 0.0;
+        const double nanosecondsPerExpansion = bucket.expansions > 0 ? bucket.searchMilliseconds * 1e6 / bucket.expansions : 0.0;
+        if (json) {
+            os << "{\"map\":" << jsonString(map) << ",\"engine\":" << jsonString(engineName(engine)) << ",\"heuristic\":" << jsonString(heuristicName(heuristic))
+                << ",\"bucket\":" << bucket.bucket << ",\"scenarios\":" << bucket.scenarios << ",\"optimal\":" << bucket.optimal
+                << ",\"cuts_corner\":" << bucket.cutsCorner << ",\"within_bound\":" << bucket.withinBound << ",\"suboptimal\":" << bucket.suboptimal
+                << ",\"mismatch\":" << bucket.mismatch << ",\"no_path\":" << bucket.noPath << ",\"worst_ratio\":" << bucket.worstRatio
+                << ",\"expansions\":" << bucket.expansions << ",\"heuristic_ms\":" << bucket.heuristicMilliseconds << ",\"search_ms\":" << bucket.searchMilliseconds
+                << ",\"us_per_query\":" << microsecondsPerQuery << ",\"ns_per_expansion\":" << nanosecondsPerExpansion << "}\n";
+        }
+        else {
+            os << csvField(map) << ',' << engineName(engine) << ',' << heuristicName(heuristic) << ',' << bucket.bucket << ',' << bucket.scenarios << ','
+                << bucket.optimal << ',' << bucket.cutsCorner << ',' << bucket.withinBound << ',' << bucket.suboptimal << ','
+                << bucket.mismatch << ',' << bucket.noPath << ',' << bucket.worstRatio << ',' << bucket.expansions << ','
+                << bucket.heuristicMilliseconds << ',' << bucket.searchMilliseconds << ',' << microsecondsPerQuery << ',' << nanosecondsPerExpansion << '\n';
+        }
+        os.flush();
+    }
+
+    // Replays MovingAI scenarios, one line per bucket and engine. Returns the number of
+    // scenarios whose paths failed the check.
+    int runScenarios(const BenchmarkOptions& options, std::ostream& os) {
+        int failures = 0;
+        for (const std::string& scenarioFile : options.scenarioFiles) {
+            // A scenario file may use several maps, each is loaded once
+            const std::vector<RPP::MovingAIScenario> scenarios = RPP::loadMovingAIScenarios(scenarioFile);
+            std::vector<std::string> mapNames;
+            for (const RPP::MovingAIScenario& scenario : scenarios) {
+                if (std::find(mapNames.begin(), mapNames.end(), scenario.mapName) == mapNames.end()) {
+                    mapNames.push_back(scenario.mapName);
+                }
+            }
+
+            for (const std::string& mapName : mapNames) {
+                std::vector<RPP::MovingAIScenario> onMap;
+                for (const RPP::MovingAIScenario& scenario : scenarios) {
+                    if (scenario.mapName == mapName) {
+                        onMap.push_back(scenario);
+                    }
+                }
+                RPP::Map map;
+                map.loadMovingAI(findScenarioMap(scenarioFile, mapName, options.mapDirectory));
+
+                for (RPP::SearchEngine engine : options.engines) {
+                    RPP::PlanParams params;
+                    params.heuristicMode = options.heuristicMode;
+                    params.engine = engine;
+                    params.weight = options.weight;
+                    const std::vector<RPP::ScenarioBucket> buckets = RPP::runMovingAIScenarios(map, onMap, params);
+
+                    int checked = 0;
+                    int failed = 0;
+                    int cornerCuts = 0;
+                    for (const RPP::ScenarioBucket& bucket : buckets) {
+                        writeScenarioBucket(os, mapName, engine, options.heuristicMode, bucket, options.json);
+                        checked += bucket.scenarios;
+                        failed += bucket.failures();
+                        cornerCuts += bucket.cutsCorner;
+                    }
+                    cerr << mapName << " " << engineName(engine) << ": " << checked << " scenarios, " << failed << " failed, "
+                        << cornerCuts << " shorter by cutting corners" << endl;
+                    failures += failed;
+                }
+            }
+        }
+        return failures;
+    }
+
+    template <typename T>
+    std::vector<T> parseList(const std::string& text) {
+        std::vector<T> values;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            std::stringstream itemStream(item);
+            T value;
+            if (!(itemStream >> value)) {
+                throw std::invalid_argument("Bad list entry: " + item);
+            }
+            values.push_back(value);
+        }
+        return values;
+    }
+
+    RPP::SearchEngine parseEngine(const std::string& name) {
+        if (name == "astar") { return RPP::SearchEngine::AStar; }
+        if (name == "jps") { return RPP::SearchEngine::JumpPoint; }
+        if (name == "bidirectional") { return RPP::SearchEngine::Bidirectional; }
+        if (name == "anytime") { return RPP::SearchEngine::Anytime; }
+        throw std::invalid_argument("Unknown engine: " + name);
+    }
+
+    RPP::HeuristicMode parseHeuristic(const std::string& name) {
+        if (name == "dijkstra") { return RPP::HeuristicMode::Dijkstra; }
+        if (name == "octile") { return RPP::HeuristicMode::Octile; }
+        if (name == "euclidean") { return RPP::HeuristicMode::Euclidean; }
+        if (name == "none") { return RPP::HeuristicMode::None; }
+        throw std::invalid_argument("Unknown heuristic: " + name);
+    }
+
+    BenchmarkOptions parseOptions(int argc, char* argv[]) {
+        BenchmarkOptions options;
+        bool generatorsGiven = false;
+        for (int i = 1; i < argc; ++i) {
+            const std::string flag = argv[i];
+            if (flag == "--help") {
+                throw std::invalid_argument("");
+            }
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value after " + flag);
+            }
+            const std::string value = argv[++i];
+            if (flag == "--sizes") {
+                options.sizes = parseList<int>(value);
+            }
+            else if (flag == "--densities") {
+                options.densities = parseList<double>(value);
+            }
+            else if (flag == "--radii") {
+                options.radii = parseList<int>(value);
+            }
+            else if (flag == "--generators") {
+                options.generators = value == "none" ? std::vector<std::string>() : parseList<std::string>(value);
+                for (const std::string& generator : options.generators) {
+                    if (generator != "circles" && generator != "maze") {
+                        throw std::invalid_argument("Unknown generator: " + generator);
+                    }
+                }
+                generatorsGiven = true;
+            }
+            else if (flag == "--map") {
+                options.mapFiles.push_back(value);
+            }
+            else if (flag == "--scen") {
+                options.scenarioFiles.push_back(value);
+            }
+            else if (flag == "--map-dir") {
+                options.mapDirectory = value;
+            }
+            else if (flag == "--engines") {
+                options.engines.clear();
+                for (const std::string& name : parseList<std::string>(value)) {
+                    options.engines.push_back(parseEngine(name));
+                }
+            }
+            else if (flag == "--heuristic") {
+                options.heuristicMode = parseHeuristic(value);
+            }
+            else if (flag == "--weight") {
+                options.weight = std::atof(value.c_str());
+                if (!(options.weight >= 1.0)) {
+                    throw std::invalid_argument("--weight must be at least 1");
+                }
+            }
+            else if (flag == "--queries") {
+                options.queries = std::atoi(value.c_str());
+            }
+            else if (flag == "--seed") {
+                options.seed = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+            }
+            else if (flag == "--format") {
+                if (value != "csv" && value != "json") {
+                    throw std::invalid_argument("Unknown format: " + value);
+                }
+                options.json = value == "json";
+            }
+            else if (flag == "--out") {
+                options.output = value;
+            }
+            else {
+                throw std::invalid_argument("Unknown option: " + flag);
+            }
+        }
+        // Recorded maps alone unless synthetic ones were asked for too
+        if (!options.mapFiles.empty() && !generatorsGiven) {
+            options.generators.clear();
+        }
+        // Scenario runs print buckets instead of phases, they do not mix with the rest
+        if (!options.scenarioFiles.empty()) {
+            if (generatorsGiven || !options.mapFiles.empty()) {
+                throw std::invalid_argument("--scen runs on its own, without --map or --generators");
+            }
+            options.generators.clear();
+        }
+        if (options.queries < 1) {
+            throw std::invalid_argument("--queries must be at least 1");
+        }
+        for (int size : options.sizes) {
+            if (size <= 0) {
+                throw std::invalid_argument("Map sizes must be positive");
+            }
+        }
+        return options;
+    }
+
+    void printUsage() {
+        cerr << "Usage: RPPBenchmark [options]\n"
+            "  --sizes 100,250,500,1000,2000,4000   square map sizes, run smallest first\n"
+            "  --densities 0.05,0.15,0.30           obstacle densities of the circle maps\n"
+            "  --radii 0,2                          robot radii\n"
+            "  --generators circles,maze            synthetic maps, none for recorded maps only\n"
+            "  --map file                           recorded map saved with Map::saveToFile, repeatable\n"
+            "  --scen file                          MovingAI scenarios to replay and check, repeatable,\n"
+            "                                       prints one line per bucket instead of the phases\n"
+            "  --map-dir dir                        where the scenario maps are, next to the .scen by default\n"
+            "  --engines astar,jps,bidirectional,anytime\n"
+            "  --heuristic octile                   dijkstra, octile, euclidean or none\n"
+            "  --weight 1                           heuristic weight, above 1 trades path length for speed\n"
+            "  --queries 5                          start and goal pairs per map and radius\n"
+            "  --seed 1\n"
+            "  --format csv                         csv or json (one object per line)\n"
+            "  --out file                           write there instead of stdout\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try {
+        const BenchmarkOptions options = parseOptions(argc, argv);
+
+        std::ofstream file;
+        if (!options.output.empty()) {
+            file.open(options.output);
+            if (!file.is_open()) {
+                throw std::runtime_error("Unable to open file: " + options.output);
+            }
+        }
+        std::ostream& os = options.output.empty() ? cout : file;
+
+        if (!options.scenarioFiles.empty()) {
+            if (!options.json) {
+                writeScenarioHeader(os);
+            }
+            // Paths that fail the optimality check fail the run
+            return runScenarios(options, os) > 0 ? 2 : 0;
+        }
+
+        if (!options.json) {
+            writeHeader(os);
+        }
+        runSynthetic(options, os);
+        runRecorded(options, os);
+    }
+    catch (const std::invalid_argument& e) {
+        if (*e.what()) {
+            cerr << e.what() << endl;
+        }
+        printUsage();
+        return 1;
+    }
+    catch (const std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <RobotMap.h>
+#include <RobotPlanner.h>
+
+// What the benchmark runs, filled in from the command line
+struct BenchmarkOptions {
+    std::vector<int> sizes;                 // Square maps of size * size cells
+    std::vector<double> densities;          // Target share of obstacle cells, circle maps only
+    std::vector<int> radii;                 // Robot radii
+    std::vector<std::string> generators;    // "circles" and/or "maze"
+    std::vector<std::string> mapFiles;      // Recorded maps, run for every radius
+    std::vector<std::string> scenarioFiles; // MovingAI .scen files, replayed on their own
+    std::string mapDirectory;               // Where the .map files of the scenarios are, next to the .scen by default
+    std::vector<RPP::SearchEngine> engines;
+    RPP::HeuristicMode heuristicMode;
+    double weight;                          // Heuristic weight, see PlanParams::weight
+    int queries;                            // Start and goal pairs per scenario
+    unsigned seed;
+    bool json;                              // JSON lines instead of CSV
+    std::string output;                     // File to write to, stdout when empty
+
+    BenchmarkOptions()
+        :
+        sizes({ 100, 250, 500, 1000, 2000, 4000 }),
+        densities({ 0.05, 0.15, 0.30 }),
+        radii({ 0, 2 }),
+        generators({ "circles", "maze" }),
+        mapFiles(),
+        scenarioFiles(),
+        mapDirectory(),
+        engines({ RPP::SearchEngine::AStar }),
+        heuristicMode(RPP::HeuristicMode::Octile),
+        weight(1.0),
+        queries(5),
+        seed(1),
+        json(false),
+        output()
+    {}
+};
+
+// One output line: a map, a robot radius and an engine, timed phase by phase
+struct BenchmarkRecord {
+    std::string generator;
+    std::string map;                        // File name for recorded maps, empty otherwise
+    int rows;
+    int cols;
+    double density;                         // Measured share of obstacle cells
+    int radius;
+    std::string engine;
+    std::string heuristic;
+    int queries;
+    int found;
+    double mapMilliseconds;                 // Map construction, or loading for recorded maps
+    double obstaclesMilliseconds;           // Stamping the obstacles and computing the clearance
+    double inflationMilliseconds;           // Traversability layer of the radius
+    double heuristicMilliseconds;           // Heuristic setup, summed over the queries
+    double searchMilliseconds;              // Searches without the path reconstruction, summed over the queries
+    double pathMilliseconds;                // Path reconstruction, summed over the queries
+    std::size_t expansions;
+    std::size_t generated;                  // See RPP::SearchStats, summed over the queries
+    std::size_t decreaseKeys;
+    std::size_t peakOpenSize;               // Largest of the queries
+    double nanosecondsPerExpansion;
+    double expansionsPerSecond;
+    std::size_t setupAllocations;           // Heap allocations building the map
+    std::size_t searchAllocations;          // Heap allocations of the queries
+    std::size_t searchAllocatedBytes;
+    std::size_t peakHeapBytes;              // Most heap in use at once during the scenario
+    std::size_t peakResidentKilobytes;      // Process peak so far, scenarios run small to large
+};
@@ -46,7 +46,12 @@ int main()
             cout << "Do you want to visualize the robots movement? (1 for Yes, 0 for No): ";
             cin >> visualize;
             if (visualize == 1 || visualize == 0) {
-                myAlgo.startPathPlanning(visualize);
+                const RPP::SearchStats stats = myAlgo.startPathPlanning(visualize);
+                if (!stats.found) {
+                    cout << "No Path Found!" << endl;
+                }
+                cout << "Expanded " << stats.expanded << " nodes, generated " << stats.generated
+                    << ", peak open set " << stats.peakOpenSize << ", search " << stats.searchMilliseconds << " ms" << endl;
             }
             else {
                 throw std::invalid_argument("Invalid entry");
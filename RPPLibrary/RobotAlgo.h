@@ -1,10 +1,12 @@
 #pragma once
 #include "RobotMap.h"
+#include "RobotHeuristic.h"
+#include "RobotPlanner.h"
+#include "RobotEvents.h"
 
 
 namespace RPP
 {
-	
 	class Algorithm
 	{
 	public:
@@ -13,46 +15,88 @@ namespace RPP
 		Algorithm()
 			:
 			map_(*(Map*)nullptr),  
-			startNode_(nullptr), 
-			endNode_(nullptr),
-			robotPosition_(nullptr),
+			startNode_(-1), 
+			endNode_(-1),
+			robotPosition_(-1),
 			path_(),
 			robotRadius_(0),
-			v_(false)
+			v_(false),
+			tieBreak_(TieBreak::LargerG),
+			engine_(SearchEngine::AStar),
+			weight_(1.0),
+			timeLimitMilliseconds_(0.0),
+			framesPerSecond_(30.0),
+			recording_(false),
+			recorded_(),
+			heuristic_(),
+			frame_()
 		{}
 
 		// Creates an algorithm object
-		Algorithm(Map& map, Node* startNode, Node* endNode, int robotRadius);
+		Algorithm(Map& map, Node* startNode, Node* endNode, int robotRadius, HeuristicMode heuristicMode = HeuristicMode::Dijkstra);
 
 		// Setters
 		void setMap(Map& map) { map_ = map; }
 
 		// Setters
-		void setRobotPosition(Node* node, bool v);
+		void setRobotPosition(int cell, bool v);
 		void setRobotRadius(int robotRadius) { robotRadius_ = robotRadius; }
+		void setTieBreak(TieBreak tieBreak) { tieBreak_ = tieBreak; }
+		void setSearchEngine(SearchEngine engine) { engine_ = engine; }
+		// Heuristic weight, see PlanParams::weight
+		void setWeight(double weight) { weight_ = weight; }
+		// Search time budget, zero for none
+		void setTimeLimit(double milliseconds) { timeLimitMilliseconds_ = milliseconds; }
+		// How often the visualizer redraws the map while the search runs
+		void setFrameRate(double framesPerSecond) { framesPerSecond_ = framesPerSecond; }
+		// Keeps the events of visualized searches, see getRecording()
+		void setRecording(bool recording) { recording_ = recording; }
+		// Switches the heuristic and redoes its setup for the current goal
+		void setHeuristicMode(HeuristicMode mode);
 		
 		// Getters
 		Map* getMap() const { return &map_; }
-		Node* getStartNode() const { return startNode_; }
-		Node* getEndNode() const { return endNode_; } 
-		Node* getRobotPosition() const { return robotPosition_; }
+		Node getStartNode() const { return map_.getNode(startNode_); }
+		Node getEndNode() const { return map_.getNode(endNode_); } 
+		Node getRobotPosition() const { return map_.getNode(robotPosition_); }
 		std::vector<Node> getPath() const { return path_; }
 		int getRobotRadius() const { return robotRadius_; }
+		TieBreak getTieBreak() const { return tieBreak_; }
+		SearchEngine getSearchEngine() const { return engine_; }
+		double getWeight() const { return weight_; }
+		double getTimeLimit() const { return timeLimitMilliseconds_; }
+		double getFrameRate() const { return framesPerSecond_; }
+		// Events of the last visualized search, for SearchRenderer::replay()
+		const std::vector<SearchEvent>& getRecording() const { return recorded_; }
+		const Heuristic& getHeuristic() const { return heuristic_; }
 		
 		void printHeuristic();
-		void startPathPlanning(bool v);
+		// Plans from the start to the end node and marks the path. Returns what the query cost,
+		// stats.found tells whether there was a path.
+		SearchStats startPathPlanning(bool v);
 
 	private:
 		Map& map_;
-		Node* startNode_;
-		Node* endNode_;
-		Node* robotPosition_;
+		int startNode_;		// Cell indices into map_
+		int endNode_;
+		int robotPosition_;
 		std::vector<Node> path_;
 		int robotRadius_;
 		bool v_;
+		TieBreak tieBreak_;
+		SearchEngine engine_;
+		double weight_;
+		double timeLimitMilliseconds_;
+		double framesPerSecond_;
+		bool recording_;
+		std::vector<SearchEvent> recorded_;
+		Heuristic heuristic_;
+		ConsoleFrame frame_;	// What visualizer() last drew
 		
-		void setNodeHeuristic();
 		void visualizer();
+		// Sets or clears a flag on every cell under the robot centered on the cell
+		void markFootprint(int center, CellFlag flag, bool value);
+		bool footprintTouchesObstacle(int center) const;
 
 	};
 }
\ No newline at end of file
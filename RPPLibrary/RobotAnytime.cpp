@@ -0,0 +1,172 @@
+#include "RobotPlanner.h"
+#include <algorithm>
+#include <limits>
+
+
+namespace RPP
+{
+	// Anytime Repairing A* (Likhachev, Gordon and Thrun). The first pass is a weighted A* search
+	// that finds a path quickly. Every later pass lowers the weight and repairs the previous
+	// search instead of starting over: G values are kept, and only the cells that got cheaper
+	// after they were closed are queued again. Each pass reports its path with a bound on how
+	// far from the best it can be, and the search stops when the bound reaches 1 or the budget
+	// runs out, keeping the best path found so far.
+
+	void Planner::anytimeSearch(const SearchInput& input, SearchContext& context, PlanResult& result) const {
+
+		const unsigned generation = context.beginSearch(map_, input.tieBreak);
+		SearchNode* nodes = context.getNodes();
+		OpenSet& openSet = context.getOpenSet();
+		const double infinity = std::numeric_limits<double>::infinity();
+
+		double weight = input.weight;
+		const double weightStep = input.weightStep > 0.0 ? input.weightStep : weight - 1.0;
+		std::vector<int> closed;			// Closed in this pass
+		std::vector<int> inconsistent;		// Got cheaper after they were closed, may hold repeats
+
+		SearchNode& start = nodes[input.start];
+		start.heuristic = input.heuristic->estimate(input.start);
+		start.gScore = 0;
+		start.f = weight * start.heuristic;
+		start.parent = -1;
+		start.generation = generation;
+		start.state = SearchState::Open;
+		openSet.push(input.start);
+		if (input.observer) {
+			input.observer->nodeOpened(input.start);
+		}
+		RPP_STATS(result.stats.generated = 1, result.stats.peakOpenSize = 1);
+
+		const SearchNode& goal = nodes[input.goal];
+		bool exhausted = false;
+
+		for (;;) {
+
+			// Improve the path: expand until no queued cell could lead to a shorter one at this weight
+			while (!openSet.empty()) {
+				if (goal.generation == generation && goal.gScore <= nodes[openSet.top()].f) {
+					break;
+				}
+				if (outOfBudget(input, result.expansions)) {
+					exhausted = true;
+					break;
+				}
+
+				const int current = openSet.pop();
+				++result.expansions;
+				if (input.observer) {
+					input.observer->nodeExpanded(current);
+				}
+				nodes[current].state = SearchState::Closed;
+				closed.push_back(current);
+
+				const double currentG = nodes[current].gScore;
+				const NeighborRange neighbors = map_.getNeighbors(current);
+				for (NeighborRange::iterator it = neighbors.begin(); it != neighbors.end(); ++it) {
+
+					const int neighbor = *it;
+					if (!isTraversable(input.traversable, neighbor)) {
+						continue;
+					}
+
+					// Cells keep their G across passes, a cell first seen in this search starts out unreached
+					SearchNode& next = nodes[neighbor];
+					if (next.generation != generation) {
+						next.heuristic = input.heuristic->estimate(neighbor);
+						next.generation = generation;
+						next.state = SearchState::Unvisited;
+						next.gScore = infinity;
+						next.parent = -1;
+					}
+					if (next.heuristic == HEURISTIC_MAX) {
+						continue;
+					}
+
+					const double tentativeGScore = currentG + NEIGHBOR_COST[it.getDirection()];
+					if (tentativeGScore >= next.gScore) {
+						continue;
+					}
+					next.gScore = tentativeGScore;
+					next.parent = current;
+
+					if (next.state == SearchState::Closed) {
+						inconsistent.push_back(neighbor);
+					}
+					else {
+						next.f = next.gScore + weight * next.heuristic;
+						if (next.state == SearchState::Open) {
+							openSet.decreaseKey(neighbor);
+							RPP_STATS(++result.stats.decreaseKeys);
+						}
+						else {
+							next.state = SearchState::Open;
+							openSet.push(neighbor);
+							if (input.observer) {
+								input.observer->nodeOpened(neighbor);
+							}
+							RPP_STATS(++result.stats.generated, result.stats.peakOpenSize = std::max(result.stats.peakOpenSize, openSet.size()));
+						}
+					}
+				}
+			}
+
+			if (goal.generation != generation || goal.gScore == infinity) {
+				// Nothing found, either the budget is gone or there is no path
+				if (exhausted) {
+					result.status = PlanStatus::TimedOut;
+				}
+				return;
+			}
+
+			// Publish the path with its bound: its cost over the least unweighted F still waiting.
+			// A pass that ran to the end also guarantees its weight, a cut short one only the ratio.
+			double lowest = infinity;
+			for (int cell : openSet.getItems()) {
+				lowest = std::min(lowest, nodes[cell].gScore + nodes[cell].heuristic);
+			}
+			for (int cell : inconsistent) {
+				lowest = std::min(lowest, nodes[cell].gScore + nodes[cell].heuristic);
+			}
+			double bound = lowest == infinity ? 1.0 : std::max(1.0, goal.gScore / lowest);
+			if (!exhausted) {
+				bound = std::min(bound, weight);
+			}
+
+			if (!result.found() || goal.gScore < result.cost) {
+				tracePath(nodes, input.goal, result);
+				result.suboptimality = bound;
+				if (input.observer) {
+					input.observer->pathImproved(result.path, result.cost, bound);
+				}
+			}
+			else {
+				result.suboptimality = std::min(result.suboptimality, bound);
+			}
+
+			if (bound <= 1.0 || exhausted || weight <= 1.0) {
+				return;
+			}
+
+			// Next pass: lower the weight, queue the inconsistent cells again and forget what was closed
+			weight = std::max(1.0, weight - weightStep);
+			for (int cell : inconsistent) {
+				if (nodes[cell].state == SearchState::Closed) {
+					nodes[cell].state = SearchState::Open;
+					openSet.push(cell);
+					RPP_STATS(++result.stats.reopened, result.stats.peakOpenSize = std::max(result.stats.peakOpenSize, openSet.size()));
+				}
+			}
+			inconsistent.clear();
+			for (int cell : closed) {
+				if (nodes[cell].state == SearchState::Closed) {
+					nodes[cell].state = SearchState::Unvisited;
+				}
+			}
+			closed.clear();
+			for (int cell : openSet.getItems()) {
+				nodes[cell].f = nodes[cell].gScore + weight * nodes[cell].heuristic;
+			}
+			openSet.rebuild();
+		}
+	}
+}
@@ -0,0 +1,196 @@
+#include "RobotBatch.h"
+#include <algorithm>
+#include <utility>
+
+
+namespace RPP
+{
+	BatchPlanner::BatchPlanner(const Map& map, unsigned threadCount)
+		:
+		planner_(map),
+		workers_(),
+		queues_(),
+		contexts_(),
+		mutex_(),
+		wake_(),
+		done_(),
+		batch_(0),
+		stopping_(false),
+		remaining_(0),
+		queries_(nullptr),
+		results_(nullptr),
+		batchStart_(),
+		steals_(0),
+		stats_()
+	{
+		if (threadCount == 0) {
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+		for (unsigned i = 0; i < threadCount; ++i) {
+			queues_.emplace_back(new WorkQueue());
+			contexts_.emplace_back(new SearchContext());
+		}
+		// Start the threads last, they read the queues and contexts
+		for (unsigned i = 0; i < threadCount; ++i) {
+			workers_.emplace_back(&BatchPlanner::workerLoop, this, i);
+		}
+	}
+
+	BatchPlanner::~BatchPlanner() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		wake_.notify_all();
+		for (std::thread& worker : workers_) {
+			worker.join();
+		}
+	}
+
+	std::vector<PlanResult> BatchPlanner::planBatch(const Query* queries, size_t count) {
+
+		std::vector<PlanResult> results(count);
+		stats_ = BatchStats();
+		stats_.queries = count;
+		stats_.threads = getThreadCount();
+		if (count == 0) {
+			return results;
+		}
+
+		// Publish the batch before dealing it out, a worker still draining the last batch may pick items up right away
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			queries_ = queries;
+			results_ = results.data();
+			batchStart_ = start;
+			steals_ = 0;
+			remaining_ = count;
+		}
+
+		// Deal the queries out in contiguous runs, neighbouring queries often share a goal and its cache lines
+		const size_t threads = queues_.size();
+		for (size_t i = 0; i < threads; ++i) {
+			const size_t begin = count * i / threads;
+			const size_t end = count * (i + 1) / threads;
+			std::lock_guard<std::mutex> lock(queues_[i]->mutex);
+			for (size_t item = begin; item < end; ++item) {
+				queues_[i]->items.push_back(item);
+			}
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			++batch_;
+			wake_.notify_all();
+			done_.wait(lock, [this] { return remaining_ == 0; });
+			queries_ = nullptr;
+			results_ = nullptr;
+		}
+
+		stats_.wallMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		stats_.queriesPerSecond = stats_.wallMilliseconds > 0.0 ? count * 1000.0 / stats_.wallMilliseconds : 0.0;
+		stats_.steals = steals_;
+		for (const PlanResult& result : results) {
+			stats_.expansions += result.expansions;
+			if (result.found()) {
+				++stats_.found;
+			}
+			else if (result.status == PlanStatus::TimedOut) {
+				++stats_.timedOut;
+			}
+		}
+		return results;
+	}
+
+	void BatchPlanner::workerLoop(unsigned worker) {
+
+		unsigned seen = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				wake_.wait(lock, [this, seen] { return stopping_ || batch_ != seen; });
+				if (stopping_) {
+					return;
+				}
+				seen = batch_;
+			}
+
+			size_t item;
+			size_t answered = 0;
+			while (takeWork(worker, item)) {
+				runQuery(worker, item);
+				++answered;
+			}
+
+			if (answered > 0) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				remaining_ -= answered;
+				if (remaining_ == 0) {
+					done_.notify_one();
+				}
+			}
+		}
+	}
+
+	bool BatchPlanner::takeWork(unsigned worker, size_t& item) {
+
+		// Own queue first, from the front
+		{
+			WorkQueue& own = *queues_[worker];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.items.empty()) {
+				item = own.items.front();
+				own.items.pop_front();
+				return true;
+			}
+		}
+
+		// Then steal from the back of the others, starting with the next worker so thieves spread out
+		const size_t threads = queues_.size();
+		for (size_t step = 1; step < threads; ++step) {
+			WorkQueue& victim = *queues_[(worker + step) % threads];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.items.empty()) {
+				item = victim.items.back();
+				victim.items.pop_back();
+				++steals_;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void BatchPlanner::runQuery(unsigned worker, size_t item) {
+
+		const Query& query = queries_[item];
+		PlanParams params = query.params;
+
+		// Turn the batch relative deadline into what is left of it now
+		if (query.deadlineMilliseconds > 0.0) {
+			const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - batchStart_).count();
+			const double left = query.deadlineMilliseconds - elapsed;
+			if (left <= 0.0) {
+				PlanResult result;
+				result.status = PlanStatus::TimedOut;
+				finishSearchStats(result);
+				results_[item] = std::move(result);
+				return;
+			}
+			if (params.timeLimitMilliseconds <= 0.0 || left < params.timeLimitMilliseconds) {
+				params.timeLimitMilliseconds = left;
+			}
+		}
+
+		results_[item] = planner_.plan(query.start, query.goal, params, *contexts_[worker]);
+	}
+
+	std::vector<PlanResult> planBatch(const Map& map, const std::vector<Query>& queries, BatchStats* stats) {
+		BatchPlanner pool(map);
+		std::vector<PlanResult> results = pool.planBatch(queries);
+		if (stats) {
+			*stats = pool.getStats();
+		}
+		return results;
+	}
+}
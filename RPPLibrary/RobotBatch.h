@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "RobotPlanner.h"
+
+
+namespace RPP
+{
+	// One start/goal request of a batch.
+	struct Query {
+		Node start;
+		Node goal;
+		PlanParams params;
+		// Time from the start of the batch by which the query must be answered, 0 for none.
+		// Queue time counts, a query still waiting when its deadline passes is answered TimedOut.
+		double deadlineMilliseconds;
+
+		Query()
+			:
+			start(),
+			goal(),
+			params(),
+			deadlineMilliseconds(0.0)
+		{}
+
+		Query(const Node& s, const Node& g, const PlanParams& p = PlanParams(), double deadline = 0.0)
+			:
+			start(s),
+			goal(g),
+			params(p),
+			deadlineMilliseconds(deadline)
+		{}
+	};
+
+	// Aggregate figures of the last batch.
+	struct BatchStats {
+		size_t queries;
+		size_t found;
+		size_t timedOut;
+		size_t expansions;		// Summed over all queries
+		size_t steals;			// Queries a worker took from another worker's queue
+		unsigned threads;
+		double wallMilliseconds;
+		double queriesPerSecond;
+
+		BatchStats()
+			:
+			queries(0),
+			found(0),
+			timedOut(0),
+			expansions(0),
+			steals(0),
+			threads(0),
+			wallMilliseconds(0.0),
+			queriesPerSecond(0.0)
+		{}
+	};
+
+	// Plans many queries on one Map across a pool of worker threads. Every worker keeps
+	// its own SearchContext for the lifetime of the pool, so no query allocates search
+	// state. Queries are dealt out in contiguous runs, one run per worker, and a worker
+	// that runs dry steals from the back of the busiest looking queue, which keeps cores
+	// busy when some queries take far longer than others.
+	// The Map must not change while a batch runs. Queries sharing a goal can share one
+	// prepared Heuristic through PlanParams::heuristic instead of each preparing its own.
+	class BatchPlanner
+	{
+	public:
+
+		// threadCount 0 uses one worker per hardware thread
+		explicit BatchPlanner(const Map& map, unsigned threadCount = 0);
+		~BatchPlanner();
+
+		BatchPlanner(const BatchPlanner&) = delete;
+		BatchPlanner& operator=(const BatchPlanner&) = delete;
+
+		// Results come back in query order. Blocks until every query is answered.
+		std::vector<PlanResult> planBatch(const Query* queries, size_t count);
+		std::vector<PlanResult> planBatch(const std::vector<Query>& queries) { return planBatch(queries.data(), queries.size()); }
+
+		// Getters
+		const BatchStats& getStats() const { return stats_; }
+		unsigned getThreadCount() const { return static_cast<unsigned>(workers_.size()); }
+
+	private:
+
+		// A worker's share of the batch. The owner takes from the front, thieves from the back.
+		struct WorkQueue {
+			std::mutex mutex;
+			std::deque<size_t> items;
+		};
+
+		Planner planner_;
+		std::vector<std::thread> workers_;
+		std::vector<std::unique_ptr<WorkQueue>> queues_;
+		std::vector<std::unique_ptr<SearchContext>> contexts_;
+
+		// Batch hand-off between the caller and the workers
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable done_;
+		unsigned batch_;			// Bumped for every batch, workers sleep until it moves
+		bool stopping_;
+		size_t remaining_;			// Queries not yet answered in the running batch
+
+		// Running batch, only valid while remaining_ > 0
+		const Query* queries_;
+		PlanResult* results_;
+		std::chrono::steady_clock::time_point batchStart_;
+		std::atomic<size_t> steals_;
+
+		BatchStats stats_;
+
+		void workerLoop(unsigned worker);
+		bool takeWork(unsigned worker, size_t& item);
+		void runQuery(unsigned worker, size_t item);
+
+	};
+
+	// One-shot convenience that spins up a pool for a single batch.
+	std::vector<PlanResult> planBatch(const Map& map, const std::vector<Query>& queries, BatchStats* stats = nullptr);
+}
@@ -0,0 +1,178 @@
+#include "RobotPlanner.h"
+#include <algorithm>
+#include <limits>
+
+
+namespace RPP
+{
+	// Bidirectional A* with average potentials (Ikeda et al.): one search grows from the start,
+	// the other from the goal, always the side with the smaller frontier. A cell is ordered by
+	// its G plus half the difference of the two heuristics, (toGoal - toStart) / 2 going forward
+	// and the opposite going backward. Both sides then see the same reduced step costs, which
+	// makes the pair a bidirectional Dijkstra search on them: once the least keys of the two
+	// open sets add up to the best meeting found so far, no undiscovered path can beat it.
+	// With one-sided bounds, max(forward F, backward F), each side would have to grow almost
+	// as far as a plain A* search before stopping.
+
+	namespace
+	{
+		// Key offset of a cell for one side, HEURISTIC_MAX when either end can not be reached from it
+		double potential(const Heuristic& toward, const Heuristic& from, int cell) {
+			const double ahead = toward.estimate(cell);
+			const double behind = from.estimate(cell);
+			if (ahead == HEURISTIC_MAX || behind == HEURISTIC_MAX) {
+				return HEURISTIC_MAX;
+			}
+			return (ahead - behind) / 2.0;
+		}
+	}
+
+	void Planner::bidirectionalSearch(const SearchInput& input, SearchContext& context, PlanResult& result) const {
+
+		const unsigned generation = context.beginSearch(map_, input.tieBreak, true);
+		SearchNode* nodes[2] = { context.getNodes(SearchSide::Forward), context.getNodes(SearchSide::Backward) };
+		OpenSet* openSets[2] = { &context.getOpenSet(SearchSide::Forward), &context.getOpenSet(SearchSide::Backward) };
+		const Heuristic* heuristics[2] = { input.heuristic, input.reverseHeuristic };
+		const int origins[2] = { input.start, input.goal };
+
+		// Seed both sides with their end of the query
+		for (int side = 0; side < 2; ++side) {
+			SearchNode& origin = nodes[side][origins[side]];
+			origin.heuristic = potential(*heuristics[side], *heuristics[1 - side], origins[side]);
+			origin.gScore = 0;
+			origin.f = origin.heuristic;
+			origin.parent = -1;
+			origin.generation = generation;
+			origin.state = SearchState::Open;
+		}
+		if (input.start == input.goal) {
+			++result.expansions;
+			tracePath(nodes[0], input.start, result);
+			return;
+		}
+		// A goal the robot does not fit on, or that one end can not see from the other, has no path
+		if (!isTraversable(input.traversable, input.goal) ||
+			nodes[0][input.start].heuristic == HEURISTIC_MAX || nodes[1][input.goal].heuristic == HEURISTIC_MAX) {
+			return;
+		}
+		openSets[0]->push(input.start);
+		openSets[1]->push(input.goal);
+		if (input.observer) {
+			input.observer->nodeOpened(input.start);
+			input.observer->nodeOpened(input.goal);
+		}
+		RPP_STATS(result.stats.generated = 2, result.stats.peakOpenSize = 2);
+
+		double best = std::numeric_limits<double>::infinity();
+		int meeting = -1;
+
+		while (!openSets[0]->empty() && !openSets[1]->empty()) {
+
+			if (outOfBudget(input, result.expansions)) {
+				result.status = PlanStatus::TimedOut;
+				return;
+			}
+
+			// Stop once no path through the two frontiers can be shorter than the best meeting
+			if (nodes[0][openSets[0]->top()].f + nodes[1][openSets[1]->top()].f >= best) {
+				break;
+			}
+
+			// Grow the smaller frontier, on long queries this keeps both about the same size
+			const int side = openSets[0]->size() <= openSets[1]->size() ? 0 : 1;
+			const int other = 1 - side;
+			SearchNode* here = nodes[side];
+			SearchNode* there = nodes[other];
+
+			const int current = openSets[side]->pop();
+			++result.expansions;
+			if (side == 1) {
+				++result.backwardExpansions;
+			}
+			if (input.observer) {
+				input.observer->nodeExpanded(current);
+			}
+			here[current].state = SearchState::Closed;
+
+			// A side that reaches the other's origin has a whole path, it does not search past it
+			if (current == origins[other]) {
+				continue;
+			}
+
+			const double currentG = here[current].gScore;
+			const NeighborRange neighbors = map_.getNeighbors(current);
+			for (NeighborRange::iterator it = neighbors.begin(); it != neighbors.end(); ++it) {
+
+				const int neighbor = *it;
+
+				// Going forward the robot lands on the neighbor, going backward it came from it.
+				// Either way it has to fit there, unless the neighbor is the start it sets off from.
+				if (!isTraversable(input.traversable, neighbor) && neighbor != input.start) {
+					continue;
+				}
+
+				SearchNode& next = here[neighbor];
+				const SearchState state = next.generation == generation ? next.state : SearchState::Unvisited;
+				if (state == SearchState::Closed) {
+					continue;
+				}
+				if (state == SearchState::Unvisited) {
+					next.heuristic = potential(*heuristics[side], *heuristics[other], neighbor);
+					if (next.heuristic == HEURISTIC_MAX) {
+						continue;
+					}
+				}
+
+				const double tentativeGScore = currentG + NEIGHBOR_COST[it.getDirection()];
+				if (state == SearchState::Unvisited) {
+					next.generation = generation;
+					next.state = SearchState::Open;
+					next.gScore = tentativeGScore;
+					next.f = next.gScore + next.heuristic;
+					next.parent = current;
+					openSets[side]->push(neighbor);
+					if (input.observer) {
+						input.observer->nodeOpened(neighbor);
+					}
+					RPP_STATS(++result.stats.generated, result.stats.peakOpenSize = std::max(result.stats.peakOpenSize, openSets[0]->size() + openSets[1]->size()));
+				}
+				else if (tentativeGScore < next.gScore) {
+					next.gScore = tentativeGScore;
+					next.f = next.gScore + next.heuristic;
+					next.parent = current;
+					openSets[side]->decreaseKey(neighbor);
+					RPP_STATS(++result.stats.decreaseKeys);
+				}
+				else {
+					continue;
+				}
+
+				// The other side got here too, the two halves join into a path
+				const SearchNode& across = there[neighbor];
+				if (across.generation == generation && next.gScore + across.gScore < best) {
+					best = next.gScore + across.gScore;
+					meeting = neighbor;
+				}
+			}
+		}
+
+		if (meeting == -1) {
+			return;
+		}
+
+		// Start to the meeting cell along the forward parents, then on to the goal along the backward ones
+#if RPP_SEARCH_STATS
+		const std::chrono::steady_clock::time_point traceStart = std::chrono::steady_clock::now();
+#endif
+		result.status = PlanStatus::Found;
+		result.cost = best;
+		for (int cell = meeting; cell != -1; cell = nodes[0][cell].parent) {
+			result.path.push_back(map_.getNode(cell));
+		}
+		std::reverse(result.path.begin(), result.path.end());
+		for (int cell = nodes[1][meeting].parent; cell != -1; cell = nodes[1][cell].parent) {
+			result.path.push_back(map_.getNode(cell));
+		}
+		RPP_STATS(result.stats.pathMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - traceStart).count());
+	}
+}
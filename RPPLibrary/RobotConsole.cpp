@@ -0,0 +1,148 @@
+#include "RobotConsole.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+
+namespace RPP
+{
+    namespace
+    {
+        const char* colorCode(ConsoleColor color) {
+            switch (color) {
+            case ConsoleColor::Red: return "\033[31m";
+            case ConsoleColor::Green: return "\033[32m";
+            case ConsoleColor::Yellow: return "\033[33m";
+            case ConsoleColor::Blue: return "\033[34m";
+            case ConsoleColor::Magenta: return "\033[35m";
+            case ConsoleColor::Cyan: return "\033[36m";
+            case ConsoleColor::Grey: return "\033[90m";
+            default: return "\033[0m";
+            }
+        }
+
+        // Rewriting a few unchanged characters is shorter than a cursor move past them
+        const int SKIP_GAP = 8;
+    }
+
+    void ConsoleFrame::begin(int lines, int width) {
+        lines_ = std::max(lines, 0);
+        width_ = std::max(width, 0);
+        const size_t cells = static_cast<size_t>(lines_) * width_;
+        chars_.assign(cells, ' ');
+        colors_.assign(cells, ConsoleColor::Default);
+    }
+
+    void ConsoleFrame::put(int line, int column, const char* text, ConsoleColor color) {
+        if (line < 0 || line >= lines_) {
+            return;
+        }
+        const size_t offset = static_cast<size_t>(line) * width_;
+        for (int col = column; *text != '\0' && col < width_; ++col, ++text) {
+            if (col >= 0) {
+                chars_[offset + col] = *text;
+                colors_[offset + col] = color;
+            }
+        }
+    }
+
+    void ConsoleFrame::putRight(int line, int column, int fieldWidth, const char* text, ConsoleColor color) {
+        const int length = static_cast<int>(std::strlen(text));
+        put(line, column + std::max(fieldWidth - length, 0), text, color);
+    }
+
+    void ConsoleFrame::appendRun(int line, int first, int last, ConsoleColor& current) {
+        const size_t offset = static_cast<size_t>(line) * width_;
+        for (int col = first; col <= last; ++col) {
+            const ConsoleColor color = colors_[offset + col];
+            if (color != current) {
+                out_ += colorCode(color);
+                current = color;
+            }
+            out_ += chars_[offset + col];
+        }
+    }
+
+    void ConsoleFrame::moveCursor(int line, int column) {
+        char code[32];
+        std::snprintf(code, sizeof(code), "\033[%d;%dH", line + 1, column + 1);
+        out_ += code;
+    }
+
+    const std::string& ConsoleFrame::flatten() {
+        out_.clear();
+        out_.reserve(static_cast<size_t>(lines_) * (width_ + 16));
+        ConsoleColor current = ConsoleColor::Default;
+        for (int line = 0; line < lines_; ++line) {
+            const size_t offset = static_cast<size_t>(line) * width_;
+            int last = width_ - 1;
+            while (last >= 0 && chars_[offset + last] == ' ') {
+                --last;
+            }
+            appendRun(line, 0, last, current);
+            if (current != ConsoleColor::Default) {
+                out_ += colorCode(ConsoleColor::Default);
+                current = ConsoleColor::Default;
+            }
+            out_ += '\n';
+        }
+        return out_;
+    }
+
+    const std::string& ConsoleFrame::diff() {
+        out_.clear();
+        out_.reserve(static_cast<size_t>(lines_) * (width_ + 16));
+        const bool redraw = lines_ != shownLines_ || width_ != shownWidth_;
+        if (redraw) {
+            // Start over on a clear screen, then the loop below sees every non blank as changed
+            out_ += "\033[H\033[2J";
+            shownChars_.assign(chars_.size(), ' ');
+            shownColors_.assign(colors_.size(), ConsoleColor::Default);
+        }
+
+        // The color the terminal is in is unknown until the first code
+        ConsoleColor current = static_cast<ConsoleColor>(0xFF);
+        bool changed = false;
+        for (int line = 0; line < lines_; ++line) {
+            const size_t offset = static_cast<size_t>(line) * width_;
+            int col = 0;
+            while (col < width_) {
+                // Find the next changed character, then extend the run over changes closer than SKIP_GAP
+                while (col < width_ && chars_[offset + col] == shownChars_[offset + col] && colors_[offset + col] == shownColors_[offset + col]) {
+                    ++col;
+                }
+                if (col == width_) {
+                    break;
+                }
+                const int first = col;
+                int last = col;
+                for (int gap = 0; col < width_ && gap < SKIP_GAP; ++col) {
+                    if (chars_[offset + col] != shownChars_[offset + col] || colors_[offset + col] != shownColors_[offset + col]) {
+                        last = col;
+                        gap = 0;
+                    }
+                    else {
+                        ++gap;
+                    }
+                }
+                moveCursor(line, first);
+                appendRun(line, first, last, current);
+                col = last + 1;
+                changed = true;
+            }
+        }
+        if (changed) {
+            // Leave the terminal in the default color with the cursor below the frame
+            if (current != ConsoleColor::Default) {
+                out_ += colorCode(ConsoleColor::Default);
+            }
+            moveCursor(lines_, 0);
+        }
+
+        shownChars_ = chars_;
+        shownColors_ = colors_;
+        shownLines_ = lines_;
+        shownWidth_ = width_;
+        return out_;
+    }
+}
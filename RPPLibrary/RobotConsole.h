@@ -0,0 +1,83 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace RPP
+{
+    // Foreground colors of the console views, each an ANSI escape code
+    enum class ConsoleColor : unsigned char {
+        Default,
+        Red,
+        Green,
+        Yellow,
+        Blue,
+        Magenta,
+        Cyan,
+        Grey
+    };
+
+    // A screen of text built in memory and sent to the console in one write.
+    // Fill a frame with begin() and put(), then send either flatten(), the whole frame as
+    // plain lines for printing in the flow of the output, or diff(), which redraws in place
+    // and only touches the characters that changed since the last diff(). Color codes are
+    // only written where the color changes. The buffers are kept across frames, so a frame
+    // of the same size costs no allocation.
+    class ConsoleFrame {
+
+        public:
+
+            ConsoleFrame()
+                :
+                lines_(0),
+                width_(0),
+                chars_(),
+                colors_(),
+                shownChars_(),
+                shownColors_(),
+                shownLines_(0),
+                shownWidth_(0),
+                out_()
+            {}
+
+            // Starts a blank frame of lines * width characters in the default color
+            void begin(int lines, int width);
+            // Writes the text from the line and column on, cut at the right edge
+            void put(int line, int column, const char* text, ConsoleColor color = ConsoleColor::Default);
+            void put(int line, int column, const std::string& text, ConsoleColor color = ConsoleColor::Default) {
+                put(line, column, text.c_str(), color);
+            }
+            // Right aligns the text in a field of fieldWidth characters, like std::setw
+            void putRight(int line, int column, int fieldWidth, const char* text, ConsoleColor color = ConsoleColor::Default);
+
+            // Getters
+            int getLines() const { return lines_; }
+            int getWidth() const { return width_; }
+
+            // The frame as lines of text, trailing blanks left out
+            const std::string& flatten();
+            // Escape codes turning the screen of the last diff() into this frame. The first
+            // frame, one of another size or one after invalidate() clears the screen and draws
+            // everything.
+            const std::string& diff();
+            // Something else wrote to the screen, the next diff() draws everything
+            void invalidate() { shownLines_ = 0; shownWidth_ = 0; }
+
+        private:
+
+            int lines_;
+            int width_;
+            std::vector<char> chars_;
+            std::vector<ConsoleColor> colors_;
+            // What the last diff() left on the screen
+            std::vector<char> shownChars_;
+            std::vector<ConsoleColor> shownColors_;
+            int shownLines_;
+            int shownWidth_;
+            std::string out_;
+
+            // Appends the characters of a line from first to last, switching colors as needed
+            void appendRun(int line, int first, int last, ConsoleColor& current);
+            void moveCursor(int line, int column);
+
+    };
+}
@@ -0,0 +1,56 @@
+#include "RobotContext.h"
+
+
+namespace RPP
+{
+	unsigned SearchContext::beginSearch(const Map& map, TieBreak tieBreak, bool bidirectional) {
+		return beginSearch(static_cast<size_t>(map.getNumCells()), static_cast<size_t>(map.getNumRows()) + map.getNumCols(), tieBreak, bidirectional);
+	}
+
+	unsigned SearchContext::beginSearch(size_t cells, size_t reserve, TieBreak tieBreak, bool bidirectional) {
+
+		Side& forward = sides_[static_cast<int>(SearchSide::Forward)];
+		Side& backward = sides_[static_cast<int>(SearchSide::Backward)];
+		if (forward.nodes.size() != cells) {
+			// A graph of another size restarts the generations, so drop the backward layer and its stale stamps too
+			backward.openSet.clear();
+			backward.nodes.clear();
+			generation_ = 0;
+		}
+		prepareSide(forward, cells, reserve, tieBreak);
+		if (bidirectional) {
+			prepareSide(backward, cells, reserve, tieBreak);
+		}
+
+		// Generation 0 is what fresh nodes carry, so skip it when the counter wraps.
+		if (++generation_ == 0) {
+			for (Side& side : sides_) {
+				for (SearchNode& node : side.nodes) {
+					node.generation = 0;
+					node.state = SearchState::Unvisited;
+				}
+			}
+			generation_ = 1;
+		}
+		return generation_;
+	}
+
+	size_t SearchContext::getMemoryBytes() const {
+		size_t bytes = 0;
+		for (const Side& side : sides_) {
+			bytes += side.nodes.capacity() * sizeof(SearchNode) + side.openSet.capacity() * sizeof(int) + side.heuristic.getMemoryBytes();
+		}
+		return bytes;
+	}
+
+	void SearchContext::prepareSide(Side& side, size_t cells, size_t reserve, TieBreak tieBreak) {
+		side.openSet.clear();
+		if (side.nodes.size() != cells) {
+			// Only a graph of another size costs an allocation
+			side.nodes.assign(cells, SearchNode());
+			side.openSet.setSlot(OpenSetSlot(side.nodes.data()));
+			side.openSet.reserve(reserve);
+		}
+		side.openSet.setLess(OpenSetLess(side.nodes.data(), tieBreak));
+	}
+}
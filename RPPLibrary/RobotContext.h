@@ -0,0 +1,132 @@
+#pragma once
+#include "RobotMap.h"
+#include "RobotQueue.h"
+#include "RobotHeuristic.h"
+
+
+namespace RPP
+{
+	// Where a node stands in the current search.
+	enum class SearchState : unsigned char {
+		Unvisited,
+		Open,
+		Closed
+	};
+
+	// Per-query A* state of one cell.
+	struct SearchNode {
+		double gScore;
+		double f;
+		double heuristic;
+		int parent;				// Cell index of the parent, -1 for none
+		int heapIndex;			// Slot in the open set heap, -1 when not queued
+		unsigned generation;	// Search that last wrote gScore, parent and state
+		SearchState state;
+
+		SearchNode()
+			:
+			gScore(0.0),
+			f(0.0),
+			heuristic(HEURISTIC_MAX),
+			parent(-1),
+			heapIndex(-1),
+			generation(0),
+			state(SearchState::Unvisited)
+		{}
+	};
+
+	// How the open set orders nodes with equal F.
+	enum class TieBreak {
+		LargerG,	// Prefer nodes closer to the goal, fewer expansions on open maps
+		SmallerG	// Prefer nodes closer to the start
+	};
+
+	// Orders open set cells by F, then by G according to the tie breaking rule.
+	struct OpenSetLess {
+		const SearchNode* nodes;
+		TieBreak tieBreak;
+
+		OpenSetLess(const SearchNode* n = nullptr, TieBreak t = TieBreak::LargerG) : nodes(n), tieBreak(t) {}
+
+		bool operator()(int a, int b) const {
+			if (nodes[a].f != nodes[b].f) {
+				return nodes[a].f < nodes[b].f;
+			}
+			if (tieBreak == TieBreak::LargerG) {
+				return nodes[a].gScore > nodes[b].gScore;
+			}
+			return nodes[a].gScore < nodes[b].gScore;
+		}
+	};
+
+	// Stores the heap slot in the cell's search state.
+	struct OpenSetSlot {
+		SearchNode* nodes;
+
+		OpenSetSlot(SearchNode* n = nullptr) : nodes(n) {}
+
+		int get(int cell) const { return nodes[cell].heapIndex; }
+		void set(int cell, int slot) const { nodes[cell].heapIndex = slot; }
+	};
+
+	typedef IndexedHeap<int, OpenSetLess, OpenSetSlot> OpenSet;
+
+	// Which end of the query a search grows from.
+	enum class SearchSide {
+		Forward,	// From the start towards the goal
+		Backward	// From the goal towards the start, only used by bidirectional searches
+	};
+
+	// Everything a search writes, kept outside the Map so the Map stays read-only while
+	// searching. One context serves one query at a time; give each thread its own and
+	// they can all plan on the same Map at once. Contexts are reused across queries:
+	// the per-cell state is generation-stamped, so a new query costs no reset and no
+	// allocation unless the map size changes. Nodes are map cells unless an engine
+	// searches a graph of its own. The backward side is only allocated once
+	// a bidirectional search asks for it.
+	class SearchContext
+	{
+	public:
+
+		SearchContext()
+			:
+			sides_(),
+			generation_(0)
+		{}
+
+		// Readies the context for a new query on the map and returns the query's generation.
+		unsigned beginSearch(const Map& map, TieBreak tieBreak, bool bidirectional = false);
+		// Same for searches over some other graph whose nodes are numbered 0 to nodeCount - 1,
+		// expecting about openSize nodes on the open set at once
+		unsigned beginSearch(size_t nodeCount, size_t openSize, TieBreak tieBreak, bool bidirectional = false);
+
+		// Getters
+		SearchNode* getNodes(SearchSide side = SearchSide::Forward) { return sides_[static_cast<int>(side)].nodes.data(); }
+		const SearchNode& getNode(int cell, SearchSide side = SearchSide::Forward) const { return sides_[static_cast<int>(side)].nodes[cell]; }
+		unsigned getGeneration() const { return generation_; }
+		// Heap memory held by the nodes, open sets and heuristics of both sides
+		size_t getMemoryBytes() const;
+		OpenSet& getOpenSet(SearchSide side = SearchSide::Forward) { return sides_[static_cast<int>(side)].openSet; }
+		Heuristic& getHeuristic(SearchSide side = SearchSide::Forward) { return sides_[static_cast<int>(side)].heuristic; }
+
+		// State of a cell in the current query
+		SearchState getState(int cell, SearchSide side = SearchSide::Forward) const {
+			const SearchNode& node = getNode(cell, side);
+			return node.generation == generation_ ? node.state : SearchState::Unvisited;
+		}
+
+	private:
+
+		struct Side {
+			std::vector<SearchNode> nodes;
+			OpenSet openSet;
+			Heuristic heuristic;	// Per-query heuristic storage for planners that prepare their own
+		};
+
+		Side sides_[2];
+		unsigned generation_;	// Shared by both sides
+
+		void prepareSide(Side& side, size_t cells, size_t reserve, TieBreak tieBreak);
+
+	};
+}
@@ -0,0 +1,411 @@
+#include "RobotDistance.h"
+#include "RobotSimd.h"
+#include <climits>
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <utility>
+
+
+namespace RPP
+{
+
+    static bool isSet(const std::uint64_t* occupancy, int index) {
+        return (occupancy[index >> 6] >> (index & 63)) & 1;
+    }
+
+    void DistanceTransform::compute(const std::uint64_t* occupancy, int numRows, int numCols, DistanceMetric metric, int* clearance, int* nearest) {
+        if (metric == DistanceMetric::Chessboard) {
+            chessboard(occupancy, numRows, numCols, clearance, nearest);
+        }
+        else {
+            euclidean(occupancy, numRows, numCols, clearance, nearest);
+        }
+    }
+
+    void DistanceTransform::chessboard(const std::uint64_t* occupancy, int numRows, int numCols, int* clearance, int* nearest) {
+        // Any real hop count is below this, so it doubles as infinity without overflowing on +1
+        const int far = numRows + numCols;
+        const GridKernels& kernels = getGridKernels();
+
+        if (nearest) {
+            // Which obstacle a cell inherits depends on the order its neighbors are looked at, that stays cell by cell
+            chessboardSites(occupancy, numRows, numCols, far, clearance, nearest);
+        }
+        else {
+            // Forward pass. The three neighbors above go a whole row at a time, the one to the left
+            // depends on the cell just done and is swept along the row after them.
+            for (int row = 0; row < numRows; ++row) {
+                int* line = clearance + static_cast<size_t>(row) * numCols;
+                kernels.maskObstacles(occupancy, static_cast<size_t>(row) * numCols, numCols, far, line);
+                if (row > 0) {
+                    kernels.chamferRow(line - numCols, numCols, line);
+                }
+                for (int col = 1; col < numCols; ++col) {
+                    line[col] = std::min(line[col], line[col - 1] + 1);
+                }
+            }
+
+            // Backward pass, the same with the row below and the neighbor to the right
+            for (int row = numRows - 1; row >= 0; --row) {
+                int* line = clearance + static_cast<size_t>(row) * numCols;
+                if (row < numRows - 1) {
+                    kernels.chamferRow(line + numCols, numCols, line);
+                }
+                for (int col = numCols - 2; col >= 0; --col) {
+                    line[col] = std::min(line[col], line[col + 1] + 1);
+                }
+            }
+        }
+
+        // Square the hop counts so both metrics share one representation
+        kernels.squareHops(clearance, static_cast<size_t>(numRows) * numCols, far);
+        columnsKept_ = false;
+    }
+
+    void DistanceTransform::chessboardSites(const std::uint64_t* occupancy, int numRows, int numCols, int far, int* clearance, int* nearest) {
+        // Forward pass, top left to bottom right, looks at the four neighbors already visited
+        for (int row = 0; row < numRows; ++row) {
+            int* line = clearance + static_cast<size_t>(row) * numCols;
+            const int* above = row > 0 ? line - numCols : line;
+            for (int col = 0; col < numCols; ++col) {
+                const int index = row * numCols + col;
+                if (isSet(occupancy, index)) {
+                    line[col] = 0;
+                    nearest[index] = index;
+                    continue;
+                }
+                int d = far;
+                int from = -1;
+                if (col > 0 && line[col - 1] + 1 < d) {
+                    d = line[col - 1] + 1;
+                    from = index - 1;
+                }
+                if (row > 0) {
+                    if (above[col] + 1 < d) {
+                        d = above[col] + 1;
+                        from = index - numCols;
+                    }
+                    if (col > 0 && above[col - 1] + 1 < d) {
+                        d = above[col - 1] + 1;
+                        from = index - numCols - 1;
+                    }
+                    if (col < numCols - 1 && above[col + 1] + 1 < d) {
+                        d = above[col + 1] + 1;
+                        from = index - numCols + 1;
+                    }
+                }
+                line[col] = d;
+                nearest[index] = from < 0 ? -1 : nearest[from];
+            }
+        }
+
+        // Backward pass, bottom right to top left, looks at the other four neighbors
+        for (int row = numRows - 1; row >= 0; --row) {
+            int* line = clearance + static_cast<size_t>(row) * numCols;
+            const int* below = row < numRows - 1 ? line + numCols : line;
+            for (int col = numCols - 1; col >= 0; --col) {
+                const int index = row * numCols + col;
+                int d = line[col];
+                int from = -1;
+                if (col < numCols - 1 && line[col + 1] + 1 < d) {
+                    d = line[col + 1] + 1;
+                    from = index + 1;
+                }
+                if (row < numRows - 1) {
+                    if (below[col] + 1 < d) {
+                        d = below[col] + 1;
+                        from = index + numCols;
+                    }
+                    if (col > 0 && below[col - 1] + 1 < d) {
+                        d = below[col - 1] + 1;
+                        from = index + numCols - 1;
+                    }
+                    if (col < numCols - 1 && below[col + 1] + 1 < d) {
+                        d = below[col + 1] + 1;
+                        from = index + numCols + 1;
+                    }
+                }
+                line[col] = d;
+                if (from >= 0) {
+                    nearest[index] = nearest[from];
+                }
+            }
+        }
+    }
+
+    void DistanceTransform::euclidean(const std::uint64_t* occupancy, int numRows, int numCols, int* clearance, int* nearest) {
+        const size_t cells = static_cast<size_t>(numRows) * numCols;
+        const GridKernels& kernels = getGridKernels();
+
+        // Pass 1, down each column and back up: distance in rows to the closest obstacle in the
+        // same column. All the columns advance together a row at a time, so memory is read in order.
+        column_.resize(cells);
+        running_.assign(numCols, COLUMN_GAP_NONE);
+        for (int row = 0; row < numRows; ++row) {
+            const size_t offset = static_cast<size_t>(row) * numCols;
+            kernels.columnDown(occupancy, offset, numCols, row > 0 ? column_.data() + offset - numCols : running_.data(), column_.data() + offset);
+        }
+        if (nearest) {
+            columnSite_.resize(cells);
+        }
+        for (int row = numRows - 1; row >= 0; --row) {
+            const size_t offset = static_cast<size_t>(row) * numCols;
+            kernels.columnUp(row, numCols, column_.data() + offset, running_.data(), nearest ? columnSite_.data() + offset : nullptr);
+        }
+
+        // Pass 2, along each row: lower envelope of the parabolas rooted at the column results
+        for (int row = 0; row < numRows; ++row) {
+            solveRow(row, numRows, numCols, clearance, nearest, nullptr);
+        }
+        columnsKept_ = nearest != nullptr;
+    }
+
+    void DistanceTransform::solveRow(int row, int numRows, int numCols, int* clearance, int* nearest, DirtyRect* dirty) {
+        const std::int64_t far = static_cast<std::int64_t>(numRows + numCols) * (numRows + numCols);
+        const size_t offset = static_cast<size_t>(row) * numCols;
+        envelope_.resize(numCols);
+        boundaries_.resize(static_cast<size_t>(numCols) + 1);
+        heights_.resize(numCols);
+        row_.resize(numCols);
+        for (int col = 0; col < numCols; ++col) {
+            const std::int64_t gap = column_[offset + col];
+            heights_[col] = gap == COLUMN_GAP_NONE ? far : gap * gap;
+        }
+        lowerEnvelope(heights_.data(), numCols, row_.data());
+        // lowerEnvelope leaves the winning parabola of every column in envelope_ order,
+        // walk it again to recover which column, and so which obstacle, won.
+        int k = 0;
+        for (int col = 0; col < numCols; ++col) {
+            const std::int64_t d = row_[col];
+            const int value = d >= far ? INT_MAX : static_cast<int>(std::min<std::int64_t>(d, INT_MAX - 1));
+            int site = -1;
+            if (nearest) {
+                while (boundaries_[k + 1] < col) {
+                    ++k;
+                }
+                const int siteCol = envelope_[k];
+                const int siteRow = columnSite_[offset + siteCol];
+                site = (siteRow < 0 || value == INT_MAX) ? -1 : siteRow * numCols + siteCol;
+            }
+            if (dirty && (value != clearance[offset + col] || (nearest && site != nearest[offset + col]))) {
+                dirty->include(row, col);
+            }
+            clearance[offset + col] = value;
+            if (nearest) {
+                nearest[offset + col] = site;
+            }
+        }
+    }
+
+    void DistanceTransform::lowerEnvelope(const std::int64_t* f, int count, std::int64_t* result) {
+        int* v = envelope_.data();
+        double* z = boundaries_.data();
+        int k = 0;
+        v[0] = 0;
+        z[0] = -1e300;
+        z[1] = 1e300;
+        for (int q = 1; q < count; ++q) {
+            const double fq = static_cast<double>(f[q]) + static_cast<double>(q) * q;
+            double s;
+            while (true) {
+                const int p = v[k];
+                s = (fq - (static_cast<double>(f[p]) + static_cast<double>(p) * p)) / (2.0 * (q - p));
+                if (s > z[k]) {
+                    break;
+                }
+                // z[0] is minus infinity, so this never walks past the first parabola
+                --k;
+            }
+            ++k;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = 1e300;
+        }
+        k = 0;
+        for (int q = 0; q < count; ++q) {
+            while (z[k + 1] < q) {
+                ++k;
+            }
+            const std::int64_t dx = q - v[k];
+            result[q] = dx * dx + f[v[k]];
+        }
+    }
+
+    void DistanceTransform::euclideanUpdate(const std::uint64_t* occupancy, int numRows, int numCols, int* clearance, int* nearest,
+        const std::vector<int>& added, const std::vector<int>& removed, DirtyRect& dirty) {
+
+        if (!columnsKept_ || column_.size() != static_cast<size_t>(numRows) * numCols) {
+            // The column pass of the map before the change is not at hand, start over
+            euclidean(occupancy, numRows, numCols, clearance, nearest);
+            dirty.include(0, 0);
+            dirty.include(numRows - 1, numCols - 1);
+            return;
+        }
+
+        // The changed cells column by column, top to bottom
+        std::vector<std::pair<int, int>> changed;
+        changed.reserve(added.size() + removed.size());
+        for (int cell : added) {
+            changed.push_back(std::make_pair(cell % numCols, cell / numCols));
+        }
+        for (int cell : removed) {
+            changed.push_back(std::make_pair(cell % numCols, cell / numCols));
+        }
+        std::sort(changed.begin(), changed.end());
+
+        // Pass 1 again over each column, only between the obstacles above and below a changed cell:
+        // no gap beyond them can change. Rows where a gap changed are marked for pass 2.
+        redoRows_.assign(numRows, 0);
+        int doneCol = -1;
+        int doneRow = -1;
+        for (const std::pair<int, int>& entry : changed) {
+            const int col = entry.first;
+            const int row = entry.second;
+            if (col == doneCol && row <= doneRow) {
+                continue;
+            }
+            int top = row;
+            while (top > 0 && !isSet(occupancy, (top - 1) * numCols + col)) {
+                --top;
+            }
+            int bottom = row;
+            while (bottom < numRows - 1 && !isSet(occupancy, (bottom + 1) * numCols + col)) {
+                ++bottom;
+            }
+            const int above = top - 1;                                 // -1 for none
+            const int below = bottom + 1 < numRows ? bottom + 1 : -1;  // -1 for none
+            const bool center = isSet(occupancy, row * numCols + col);
+            for (int r = top; r <= bottom; ++r) {
+                // Same choice as the column pass: the closer obstacle, the one above on ties
+                int siteAbove = above;
+                if (center && r >= row) {
+                    siteAbove = row;
+                }
+                int siteBelow = below;
+                if (center && r < row) {
+                    siteBelow = row;
+                }
+                const int down = siteAbove < 0 ? COLUMN_GAP_NONE : r - siteAbove;
+                const int up = siteBelow < 0 ? COLUMN_GAP_NONE : siteBelow - r;
+                const int gap = std::min(down, up);
+                const int site = gap == COLUMN_GAP_NONE ? -1 : (down == gap ? siteAbove : siteBelow);
+                const size_t index = static_cast<size_t>(r) * numCols + col;
+                if (column_[index] != gap || columnSite_[index] != site) {
+                    column_[index] = gap;
+                    columnSite_[index] = site;
+                    redoRows_[r] = 1;
+                }
+            }
+            doneCol = col;
+            doneRow = bottom;
+        }
+
+        // Pass 2 over the marked rows, as a whole: a changed gap can win or lose anywhere along the row
+        for (int row = 0; row < numRows; ++row) {
+            if (redoRows_[row]) {
+                solveRow(row, numRows, numCols, clearance, nearest, &dirty);
+            }
+        }
+    }
+
+    // Squared distance between two cells under the metric
+    static int metricDistance(DistanceMetric metric, int rowA, int colA, int rowB, int colB) {
+        const int dRow = std::abs(rowA - rowB);
+        const int dCol = std::abs(colA - colB);
+        if (metric == DistanceMetric::Chessboard) {
+            const int d = std::max(dRow, dCol);
+            return d * d;
+        }
+        return dRow * dRow + dCol * dCol;
+    }
+
+    void DistanceTransform::update(const std::uint64_t* occupancy, int numRows, int numCols, DistanceMetric metric, int* clearance, int* nearest,
+        const std::vector<int>& added, const std::vector<int>& removed, DirtyRect& dirty) {
+
+        if (metric == DistanceMetric::Euclidean) {
+            euclideanUpdate(occupancy, numRows, numCols, clearance, nearest, added, removed, dirty);
+            return;
+        }
+        columnsKept_ = false;
+
+        typedef std::pair<int, int> Entry;     // (squared distance, cell)
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+        raise_.resize(static_cast<size_t>(numRows) * numCols, 0);
+
+        // Seed the wavefronts, new obstacles lower their surroundings, freed cells raise them
+        for (int cell : added) {
+            clearance[cell] = 0;
+            nearest[cell] = cell;
+            open.push(Entry(0, cell));
+            dirty.include(cell / numCols, cell % numCols);
+        }
+        for (int cell : removed) {
+            clearance[cell] = INT_MAX;
+            nearest[cell] = -1;
+            raise_[cell] = 1;
+            open.push(Entry(0, cell));
+            dirty.include(cell / numCols, cell % numCols);
+        }
+
+        while (!open.empty()) {
+            const int cell = open.top().second;
+            open.pop();
+            const int row = cell / numCols;
+            const int col = cell % numCols;
+
+            if (raise_[cell]) {
+                // Raise: neighbors that pointed at an obstacle that is gone are cleared and
+                // raised in turn, neighbors with a valid obstacle become sources for lowering.
+                for (int r = row - 1; r <= row + 1; ++r) {
+                    for (int c = col - 1; c <= col + 1; ++c) {
+                        if (r < 0 || c < 0 || r >= numRows || c >= numCols || (r == row && c == col)) {
+                            continue;
+                        }
+                        const int neighbor = r * numCols + c;
+                        if (nearest[neighbor] < 0 || raise_[neighbor]) {
+                            continue;
+                        }
+                        open.push(Entry(clearance[neighbor], neighbor));
+                        if (!isSet(occupancy, nearest[neighbor])) {
+                            clearance[neighbor] = INT_MAX;
+                            nearest[neighbor] = -1;
+                            raise_[neighbor] = 1;
+                            dirty.include(r, c);
+                        }
+                    }
+                }
+                raise_[cell] = 0;
+                continue;
+            }
+
+            const int site = nearest[cell];
+            if (site < 0 || !isSet(occupancy, site)) {
+                continue;
+            }
+
+            // Lower: offer this cell's obstacle to every neighbor it is closer to
+            const int siteRow = site / numCols;
+            const int siteCol = site % numCols;
+            for (int r = row - 1; r <= row + 1; ++r) {
+                for (int c = col - 1; c <= col + 1; ++c) {
+                    if (r < 0 || c < 0 || r >= numRows || c >= numCols || (r == row && c == col)) {
+                        continue;
+                    }
+                    const int neighbor = r * numCols + c;
+                    if (raise_[neighbor]) {
+                        continue;
+                    }
+                    const int d = metricDistance(metric, r, c, siteRow, siteCol);
+                    if (d < clearance[neighbor]) {
+                        clearance[neighbor] = d;
+                        nearest[neighbor] = site;
+                        open.push(Entry(d, neighbor));
+                        dirty.include(r, c);
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+namespace RPP
+{
+    // How the clearance of a cell to its closest obstacle is measured.
+    enum class DistanceMetric {
+        Chessboard,     // Eight-connected hop count
+        Euclidean       // Exact straight line distance between cell centers
+    };
+
+    // Inclusive bounding box of the cells an update touched, empty when nothing changed.
+    struct DirtyRect {
+        int minRow;
+        int minCol;
+        int maxRow;
+        int maxCol;
+
+        DirtyRect()
+            :
+            minRow(INT_MAX),
+            minCol(INT_MAX),
+            maxRow(-1),
+            maxCol(-1)
+        {}
+
+        bool isEmpty() const { return minRow > maxRow; }
+
+        void include(int row, int col) {
+            if (row < minRow) { minRow = row; }
+            if (row > maxRow) { maxRow = row; }
+            if (col < minCol) { minCol = col; }
+            if (col > maxCol) { maxCol = col; }
+        }
+
+        void include(const DirtyRect& other) {
+            if (!other.isEmpty()) {
+                include(other.minRow, other.minCol);
+                include(other.maxRow, other.maxCol);
+            }
+        }
+    };
+
+    // Distance transform of an occupancy bitmap.
+    // Writes the squared distance from every cell to the closest obstacle cell into
+    // clearance (numRows * numCols entries, row-major), 0 on obstacles and INT_MAX
+    // when the map has no obstacles. Both metrics run in O(N): the chessboard metric
+    // with a forward and a backward chamfer pass, the Euclidean metric with the
+    // separable two-pass transform of Felzenszwalb and Huttenlocher. The row-wise inner loops
+    // run on the GridKernels of RobotSimd.h, whose levels all give the same result.
+    // When nearest is given it receives the index of that closest obstacle cell (-1 for none),
+    // which is what update() needs to repair the clearance locally later on.
+    class DistanceTransform {
+
+        public:
+
+            DistanceTransform()
+                :
+                column_(),
+                columnSite_(),
+                running_(),
+                heights_(),
+                envelope_(),
+                boundaries_(),
+                row_(),
+                raise_(),
+                redoRows_(),
+                columnsKept_(false)
+            {}
+
+            void compute(const std::uint64_t* occupancy, int numRows, int numCols, DistanceMetric metric, int* clearance, int* nearest = nullptr);
+
+            // Repairs clearance and nearest after the cells in added became obstacles and the
+            // cells in removed stopped being obstacles (occupancy already reflects both).
+            // The result is exactly what compute() would give, for either metric.
+            // Chessboard runs a dynamic brushfire: cells that lost their closest obstacle are
+            // raised, then a lowering wavefront spreads outwards only as far as distances
+            // actually shrink. Passing closest obstacles between neighbors is not exact for the
+            // Euclidean metric, so it redoes the column pass of compute() only along the changed
+            // columns, between the obstacles above and below each change, and then pass 2 of
+            // every row where a column distance changed. Its cost grows with the length of those
+            // free runs times the width of the map. That needs the column pass of the map as it
+            // was, kept by the last compute() or update() with nearest. Without it the whole
+            // transform is redone.
+            // Every cell whose clearance was written is included in dirty.
+            void update(const std::uint64_t* occupancy, int numRows, int numCols, DistanceMetric metric, int* clearance, int* nearest,
+                const std::vector<int>& added, const std::vector<int>& removed, DirtyRect& dirty);
+
+        private:
+
+            // Scratch buffers kept between calls
+            std::vector<int> column_;
+            std::vector<int> columnSite_;
+            std::vector<int> running_;
+            std::vector<std::int64_t> heights_;
+            std::vector<int> envelope_;
+            std::vector<double> boundaries_;
+            std::vector<std::int64_t> row_;
+            std::vector<unsigned char> raise_;
+            std::vector<unsigned char> redoRows_;
+            bool columnsKept_;                  // column_ and columnSite_ hold the column pass of the last compute() or update()
+
+            void chessboard(const std::uint64_t* occupancy, int numRows, int numCols, int* clearance, int* nearest);
+            void chessboardSites(const std::uint64_t* occupancy, int numRows, int numCols, int far, int* clearance, int* nearest);
+            void euclidean(const std::uint64_t* occupancy, int numRows, int numCols, int* clearance, int* nearest);
+            void euclideanUpdate(const std::uint64_t* occupancy, int numRows, int numCols, int* clearance, int* nearest,
+                const std::vector<int>& added, const std::vector<int>& removed, DirtyRect& dirty);
+            // Pass 2 of the Euclidean transform for one row, from the column pass in column_ and columnSite_.
+            // With dirty, the cells whose clearance or closest obstacle changed are included in it.
+            void solveRow(int row, int numRows, int numCols, int* clearance, int* nearest, DirtyRect* dirty);
+            void lowerEnvelope(const std::int64_t* f, int count, std::int64_t* result);
+    };
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace RPP
+{
+	enum class SearchEventType : unsigned char {
+		NodeOpened,		// cell went on the open set
+		NodeExpanded,	// cell came off the open set, the robot stands on it
+		PathNode,		// cell is the next node of a path, the path ends with PathFound
+		PathFound,		// The path nodes sent since the last PathFound make a path of length value
+		SearchDone		// Nothing follows
+	};
+
+	struct SearchEvent {
+		SearchEventType type;
+		int cell;		// -1 for events without a cell
+		double value;	// Path length for PathFound, 0 otherwise
+
+		SearchEvent(SearchEventType t = SearchEventType::SearchDone, int c = -1, double v = 0.0) : type(t), cell(c), value(v) {}
+	};
+
+	// Lock-free ring buffer of search events between exactly one producer thread, the search,
+	// and one consumer thread, the renderer. Neither side ever waits on the other: push() fails
+	// when the ring is full and pop() when it is empty. The capacity is rounded up to a power
+	// of two.
+	class SearchEventRing
+	{
+	public:
+
+		explicit SearchEventRing(size_t capacity = 1 << 16)
+			:
+			slots_(roundUp(capacity)),
+			mask_(slots_.size() - 1),
+			head_(0),
+			tailCache_(0),
+			tail_(0),
+			headCache_(0)
+		{}
+
+		SearchEventRing(const SearchEventRing&) = delete;
+		SearchEventRing& operator=(const SearchEventRing&) = delete;
+
+		size_t getCapacity() const { return slots_.size(); }
+
+		// Producer side
+		bool push(const SearchEvent& event) {
+			const size_t head = head_.load(std::memory_order_relaxed);
+			if (head - tailCache_ == slots_.size()) {
+				// Looks full, see how far the consumer got before giving up
+				tailCache_ = tail_.load(std::memory_order_acquire);
+				if (head - tailCache_ == slots_.size()) {
+					return false;
+				}
+			}
+			slots_[head & mask_] = event;
+			head_.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer side
+		bool pop(SearchEvent& event) {
+			const size_t tail = tail_.load(std::memory_order_relaxed);
+			if (tail == headCache_) {
+				headCache_ = head_.load(std::memory_order_acquire);
+				if (tail == headCache_) {
+					return false;
+				}
+			}
+			event = slots_[tail & mask_];
+			tail_.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+
+		static size_t roundUp(size_t capacity) {
+			size_t size = 2;
+			while (size < capacity) {
+				size <<= 1;
+			}
+			return size;
+		}
+
+		std::vector<SearchEvent> slots_;
+		size_t mask_;
+
+		// Each side writes its own index and keeps a stale copy of the other one, on separate
+		// cache lines so the two threads do not keep stealing the line from each other
+		char producerPad_[64];
+		std::atomic<size_t> head_;		// Next slot to write
+		size_t tailCache_;
+		char consumerPad_[64];
+		std::atomic<size_t> tail_;		// Next slot to read
+		size_t headCache_;
+		char endPad_[64];
+
+	};
+}
@@ -0,0 +1,75 @@
+#include "RobotHeuristic.h"
+#include <chrono>
+
+
+namespace RPP
+{
+	// Orders cells by their distance to the goal for the backward pass.
+	struct DistanceLess {
+		const double* distance;
+		bool operator()(int a, int b) const { return distance[a] < distance[b]; }
+	};
+
+	struct DistanceSlot {
+		int* slots;
+		int get(int cell) const { return slots[cell]; }
+		void set(int cell, int slot) const { slots[cell] = slot; }
+	};
+
+	void Heuristic::prepare(const Map& map, int goal, int robotRadius) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		goalRow_ = map.getRow(goal);
+		goalCol_ = map.getCol(goal);
+		numCols_ = map.getNumCols();
+
+		if (mode_ == HeuristicMode::Dijkstra) {
+			backwardDijkstra(map, goal, robotRadius);
+		}
+		else {
+			// Closed form modes hold no per cell data
+			distance_.clear();
+			distance_.shrink_to_fit();
+			slot_.clear();
+			slot_.shrink_to_fit();
+		}
+
+		setupMilliseconds_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void Heuristic::backwardDijkstra(const Map& map, int goal, int robotRadius) {
+		// Run one Dijkstra search outwards from the goal over the moves the robot can make.
+		// Steps are symmetric, so the distance found for a cell is its exact cost to the goal.
+		distance_.assign(map.getNumCells(), HEURISTIC_MAX);
+		slot_.assign(map.getNumCells(), -1);
+
+		IndexedHeap<int, DistanceLess, DistanceSlot> open(DistanceLess{ distance_.data() }, DistanceSlot{ slot_.data() });
+		const std::uint64_t* traversable = map.getTraversable(robotRadius);
+		distance_[goal] = 0;
+		open.push(goal);
+
+		while (!open.empty()) {
+			const int current = open.pop();
+			const double currentDistance = distance_[current];
+
+			const NeighborRange neighbors = map.getNeighbors(current);
+			for (NeighborRange::iterator it = neighbors.begin(); it != neighbors.end(); ++it) {
+				const int neighbor = *it;
+				const double distance = currentDistance + NEIGHBOR_COST[it.getDirection()];
+				if (distance >= distance_[neighbor]) {
+					continue;
+				}
+				const bool queued = slot_[neighbor] >= 0;
+				distance_[neighbor] = distance;
+				// A cell the robot does not fit on can still step into current, it just
+				// can not be stepped through, so it gets a distance but is not expanded.
+				if (queued) {
+					open.decreaseKey(neighbor);
+				}
+				else if (isTraversable(traversable, neighbor)) {
+					open.push(neighbor);
+				}
+			}
+		}
+	}
+}
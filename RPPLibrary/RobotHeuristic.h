@@ -0,0 +1,84 @@
+#pragma once
+#include "RobotMap.h"
+#include "RobotQueue.h"
+#include <cmath>
+#include <cstdlib>
+
+
+namespace RPP
+{
+	// Heuristic of a cell the goal can not be reached from.
+	const double HEURISTIC_MAX = 999999999;
+
+	// Where the A* heuristic comes from.
+	enum class HeuristicMode {
+		Dijkstra,	// Exact distance to the goal, one backward Dijkstra pass before the search
+		Octile,		// Closed form eight-connected distance, computed when a cell is first reached
+		Euclidean,	// Closed form straight line distance, computed when a cell is first reached
+		None		// Always zero, plain Dijkstra search with no setup
+	};
+
+	// Estimates the remaining cost from a cell to the goal.
+	// Only the Dijkstra mode does work up front, the closed form modes are evaluated
+	// lazily by the search the first time it touches a cell.
+	class Heuristic
+	{
+	public:
+
+		Heuristic(HeuristicMode mode = HeuristicMode::Dijkstra)
+			:
+			mode_(mode),
+			goalRow_(0),
+			goalCol_(0),
+			numCols_(1),
+			distance_(),
+			slot_(),
+			setupMilliseconds_(0.0)
+		{}
+
+		// Setters
+		void setMode(HeuristicMode mode) { mode_ = mode; }
+
+		// Getters
+		HeuristicMode getMode() const { return mode_; }
+		// Wall time of the last prepare() call
+		double getSetupMilliseconds() const { return setupMilliseconds_; }
+		// Heap memory held by the per-cell tables
+		size_t getMemoryBytes() const { return distance_.capacity() * sizeof(double) + slot_.capacity() * sizeof(int); }
+
+		// Readies the heuristic for a goal and robot radius on the given map.
+		void prepare(const Map& map, int goal, int robotRadius);
+
+		// Remaining cost from cell to the goal, HEURISTIC_MAX if the goal can not be reached.
+		double estimate(int cell) const {
+			int dRow, dCol;
+			switch (mode_) {
+			case HeuristicMode::Dijkstra:
+				return distance_[cell];
+			case HeuristicMode::Octile:
+				dRow = std::abs(cell / numCols_ - goalRow_);
+				dCol = std::abs(cell % numCols_ - goalCol_);
+				return dRow < dCol ? (dCol - dRow) + 1.4142135623730951 * dRow : (dRow - dCol) + 1.4142135623730951 * dCol;
+			case HeuristicMode::Euclidean:
+				dRow = cell / numCols_ - goalRow_;
+				dCol = cell % numCols_ - goalCol_;
+				return std::sqrt(static_cast<double>(dRow * dRow + dCol * dCol));
+			default:
+				return 0.0;
+			}
+		}
+
+	private:
+		HeuristicMode mode_;
+		int goalRow_;
+		int goalCol_;
+		int numCols_;
+		std::vector<double> distance_;	// Dijkstra mode only, distance to the goal per cell
+		std::vector<int> slot_;			// Heap slots for the Dijkstra pass
+
+		double setupMilliseconds_;
+
+		void backwardDijkstra(const Map& map, int goal, int robotRadius);
+
+	};
+}
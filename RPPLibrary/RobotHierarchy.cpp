@@ -0,0 +1,798 @@
+#include "RobotHierarchy.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+
+namespace RPP
+{
+	namespace
+	{
+		const double UNREACHABLE = std::numeric_limits<double>::infinity();
+
+		// Length of the shortest eight-connected route across rows by cols cells on an empty grid
+		double octile(int rows, int cols) {
+			rows = std::abs(rows);
+			cols = std::abs(cols);
+			const int diagonal = std::min(rows, cols);
+			return (std::max(rows, cols) - diagonal) + diagonal * NEIGHBOR_COST[0];
+		}
+
+		double octileDistance(const Map& map, int from, int to) {
+			return octile(map.getRow(from) - map.getRow(to), map.getCol(from) - map.getCol(to));
+		}
+
+		// Search confined to the cells of one cluster. Towards one target it is an A* search that
+		// stops there, towards a list of them a Dijkstra search that stops once all are settled.
+		class ClusterSearch
+		{
+		public:
+
+			ClusterSearch(const Map& map, int robotRadius, int clusterSize)
+				:
+				map_(map),
+				robotRadius_(robotRadius),
+				row_(0),
+				col_(0),
+				rows_(0),
+				cols_(0),
+				distance_(static_cast<size_t>(clusterSize) * clusterSize),
+				key_(distance_.size()),
+				slot_(distance_.size()),
+				parent_(distance_.size()),
+				closed_(distance_.size()),
+				wanted_(distance_.size()),
+				open_()
+			{
+				open_.setLess(KeyLess(key_.data()));
+				open_.setSlot(KeySlot(slot_.data()));
+			}
+
+			// Both return the number of cells expanded. The origin may be a cell the robot does not fit on.
+			size_t run(int row, int col, int rows, int cols, int origin, int target) {
+				return search(row, col, rows, cols, origin, target, nullptr);
+			}
+			size_t run(int row, int col, int rows, int cols, int origin, const std::vector<int>& targets) {
+				return search(row, col, rows, cols, origin, -1, &targets);
+			}
+
+			// Distance from the origin of the last run, infinity when it was not reached
+			double distance(int target) const { return distance_[local(target)]; }
+
+			// Appends the cells after the origin up to the target
+			void appendPath(int target, std::vector<Node>& path) const {
+				const size_t first = path.size();
+				for (int current = local(target); parent_[current] != -1; current = parent_[current]) {
+					path.push_back(map_.getNode(cell(current)));
+				}
+				std::reverse(path.begin() + first, path.end());
+			}
+
+		private:
+
+			size_t search(int row, int col, int rows, int cols, int origin, int target, const std::vector<int>* targets) {
+				row_ = row;
+				col_ = col;
+				rows_ = rows;
+				cols_ = cols;
+				const size_t cells = static_cast<size_t>(rows) * cols;
+				std::fill(distance_.begin(), distance_.begin() + cells, UNREACHABLE);
+				std::fill(slot_.begin(), slot_.begin() + cells, -1);
+				std::fill(parent_.begin(), parent_.begin() + cells, -1);
+				std::fill(closed_.begin(), closed_.begin() + cells, 0);
+				open_.clear();
+				size_t remaining = 0;
+				if (targets) {
+					std::fill(wanted_.begin(), wanted_.begin() + cells, 0);
+					for (int wanted : *targets) {
+						remaining += wanted_[local(wanted)] == 0;
+						wanted_[local(wanted)] = 1;
+					}
+				}
+
+				// Local coordinates of the target, the heuristic and the stop test stay within the cluster
+				const int goal = target == -1 ? -1 : local(target);
+				const int goalRow = target == -1 ? 0 : goal / cols_;
+				const int goalCol = target == -1 ? 0 : goal % cols_;
+				const int start = local(origin);
+				distance_[start] = 0.0;
+				key_[start] = target == -1 ? 0.0 : octile(start / cols_ - goalRow, start % cols_ - goalCol);
+				open_.push(start);
+
+				size_t expansions = 0;
+				while (!open_.empty()) {
+					const int current = open_.pop();
+					closed_[current] = 1;
+					++expansions;
+					if (current == goal || (targets && wanted_[current] && --remaining == 0)) {
+						break;
+					}
+
+					const int currentRow = current / cols_;
+					const int currentCol = current % cols_;
+					for (int direction = 0; direction < 8; ++direction) {
+						const int nextRow = currentRow + NEIGHBOR_ROW[direction];
+						const int nextCol = currentCol + NEIGHBOR_COL[direction];
+						if (nextRow < 0 || nextCol < 0 || nextRow >= rows_ || nextCol >= cols_) {
+							continue;
+						}
+						const int next = nextRow * cols_ + nextCol;
+						if (closed_[next] || !map_.robotFits(map_.getIndex(row_ + nextRow, col_ + nextCol), robotRadius_)) {
+							continue;
+						}
+						const double distance = distance_[current] + NEIGHBOR_COST[direction];
+						if (distance >= distance_[next]) {
+							continue;
+						}
+						distance_[next] = distance;
+						key_[next] = distance + (target == -1 ? 0.0 : octile(nextRow - goalRow, nextCol - goalCol));
+						parent_[next] = current;
+						if (slot_[next] >= 0) {
+							open_.decreaseKey(next);
+						}
+						else {
+							open_.push(next);
+						}
+					}
+				}
+				open_.clear();
+				return expansions;
+			}
+
+			struct KeyLess {
+				const double* keys;
+				KeyLess(const double* k = nullptr) : keys(k) {}
+				bool operator()(int a, int b) const { return keys[a] < keys[b]; }
+			};
+
+			struct KeySlot {
+				int* slots;
+				KeySlot(int* s = nullptr) : slots(s) {}
+				int get(int item) const { return slots[item]; }
+				void set(int item, int slot) const { slots[item] = slot; }
+			};
+
+			const Map& map_;
+			int robotRadius_;
+			int row_;
+			int col_;
+			int rows_;
+			int cols_;
+			std::vector<double> distance_;
+			std::vector<double> key_;
+			std::vector<int> slot_;
+			std::vector<int> parent_;
+			std::vector<unsigned char> closed_;
+			std::vector<unsigned char> wanted_;		// Targets of a Dijkstra search not settled yet
+			IndexedHeap<int, KeyLess, KeySlot> open_;
+
+			int local(int cell) const { return (map_.getRow(cell) - row_) * cols_ + map_.getCol(cell) - col_; }
+			int cell(int local) const { return map_.getIndex(row_ + local / cols_, col_ + local % cols_); }
+		};
+
+		// Walks the eight-connected line from one cell to another, a Bresenham line of exactly the
+		// octile length. Returns false at the first cell the robot does not fit on, the cells after
+		// from are appended to cells when given.
+		bool traceLine(const Map& map, int robotRadius, const Node& from, const Node& to, std::vector<Node>* cells) {
+			int row = from.getRow();
+			int col = from.getCol();
+			const int dRow = std::abs(to.getRow() - row);
+			const int dCol = std::abs(to.getCol() - col);
+			const int stepRow = to.getRow() > row ? 1 : -1;
+			const int stepCol = to.getCol() > col ? 1 : -1;
+			int error = dCol - dRow;
+			while (row != to.getRow() || col != to.getCol()) {
+				const int twice = 2 * error;
+				if (twice > -dRow) {
+					error -= dRow;
+					col += stepCol;
+				}
+				if (twice < dCol) {
+					error += dCol;
+					row += stepRow;
+				}
+				if (!map.robotFits(map.getIndex(row, col), robotRadius)) {
+					return false;
+				}
+				if (cells) {
+					cells->push_back(Node(row, col));
+				}
+			}
+			return true;
+		}
+
+		// String pulling: from each cell kept, the path goes straight to the farthest cell ahead it can
+		// see, looking at most span cells ahead. A line is never longer than the steps it replaces.
+		// The path runs straight between turns, so the turns are tried first and single cells only
+		// along the run after the last turn seen. Returns the length of the new path.
+		double shortenPath(const Map& map, int robotRadius, size_t span, std::vector<Node>& path) {
+			const auto step = [&](size_t i) {
+				return std::make_pair(path[i + 1].getRow() - path[i].getRow(), path[i + 1].getCol() - path[i].getCol());
+			};
+			std::vector<size_t> turns;
+			for (size_t i = 1; i + 1 < path.size(); ++i) {
+				if (step(i - 1) != step(i)) {
+					turns.push_back(i);
+				}
+			}
+			turns.push_back(path.size() - 1);
+
+			std::vector<Node> shortened;
+			shortened.reserve(path.size());
+			shortened.push_back(path.front());
+			size_t anchor = 0;
+			size_t turn = 0;
+			while (anchor + 1 < path.size()) {
+				size_t reach = anchor + 1;
+				while (turn < turns.size() && turns[turn] <= reach) {
+					++turn;
+				}
+				while (turn < turns.size() && turns[turn] <= anchor + span && traceLine(map, robotRadius, path[anchor], path[turns[turn]], nullptr)) {
+					reach = turns[turn++];
+				}
+				while (reach + 1 < path.size() && reach < anchor + span && traceLine(map, robotRadius, path[anchor], path[reach + 1], nullptr)) {
+					++reach;
+				}
+				traceLine(map, robotRadius, path[anchor], path[reach], &shortened);
+				anchor = reach;
+			}
+			path.swap(shortened);
+
+			double cost = 0.0;
+			for (size_t i = 1; i < path.size(); ++i) {
+				const bool diagonal = path[i].getRow() != path[i - 1].getRow() && path[i].getCol() != path[i - 1].getCol();
+				cost += diagonal ? NEIGHBOR_COST[0] : NEIGHBOR_COST[1];
+			}
+			return cost;
+		}
+	}
+
+	HierarchicalPlanner::HierarchicalPlanner(const Map& map, int robotRadius, int clusterSize)
+		:
+		map_(map),
+		robotRadius_(robotRadius),
+		clusterSize_(clusterSize),
+		clusterRows_(0),
+		clusterCols_(0),
+		clusters_(),
+		eastBorders_(),
+		southBorders_(),
+		southEastCorners_(),
+		southWestCorners_(),
+		entranceCells_(),
+		entranceClusters_(),
+		entranceNodes_(),
+		version_(0),
+		buildMilliseconds_(0.0),
+		context_()
+	{
+		if (clusterSize < 2) {
+			throw std::invalid_argument("Cluster size must be at least 2");
+		}
+		rebuild();
+	}
+
+	void HierarchicalPlanner::rebuild() {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		clusterRows_ = (map_.getNumRows() + clusterSize_ - 1) / clusterSize_;
+		clusterCols_ = (map_.getNumCols() + clusterSize_ - 1) / clusterSize_;
+		const int count = clusterRows_ * clusterCols_;
+		clusters_.assign(count, Cluster());
+		for (int i = 0; i < count; ++i) {
+			Cluster& cluster = clusters_[i];
+			cluster.row = (i / clusterCols_) * clusterSize_;
+			cluster.col = (i % clusterCols_) * clusterSize_;
+			cluster.rows = std::min(clusterSize_, map_.getNumRows() - cluster.row);
+			cluster.cols = std::min(clusterSize_, map_.getNumCols() - cluster.col);
+		}
+		eastBorders_.assign(count, std::vector<Transition>());
+		southBorders_.assign(count, std::vector<Transition>());
+		southEastCorners_.assign(count, std::vector<Transition>());
+		southWestCorners_.assign(count, std::vector<Transition>());
+
+		for (int i = 0; i < count; ++i) {
+			computeEastBorder(i);
+			computeSouthBorder(i);
+			computeCorners(i);
+		}
+		for (int i = 0; i < count; ++i) {
+			deriveCluster(i, true);
+		}
+		numberEntrances();
+
+		version_ = map_.getVersion();
+		buildMilliseconds_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void HierarchicalPlanner::update(const DirtyRect& dirty) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		if (!dirty.isEmpty()) {
+			const int firstRow = std::max(dirty.minRow, 0) / clusterSize_;
+			const int lastRow = std::min(dirty.maxRow, map_.getNumRows() - 1) / clusterSize_;
+			const int firstCol = std::max(dirty.minCol, 0) / clusterSize_;
+			const int lastCol = std::min(dirty.maxCol, map_.getNumCols() - 1) / clusterSize_;
+
+			for (int row = firstRow; row <= lastRow; ++row) {
+				for (int col = firstCol; col <= lastCol; ++col) {
+					computeBordersAround(row * clusterCols_ + col);
+				}
+			}
+
+			// The touched clusters changed inside, their neighbors at most along the shared borders
+			for (int row = std::max(firstRow - 1, 0); row <= std::min(lastRow + 1, clusterRows_ - 1); ++row) {
+				for (int col = std::max(firstCol - 1, 0); col <= std::min(lastCol + 1, clusterCols_ - 1); ++col) {
+					const bool touched = row >= firstRow && row <= lastRow && col >= firstCol && col <= lastCol;
+					deriveCluster(row * clusterCols_ + col, touched);
+				}
+			}
+			numberEntrances();
+		}
+
+		version_ = map_.getVersion();
+		buildMilliseconds_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void HierarchicalPlanner::computeBordersAround(int cluster) {
+		const int row = cluster / clusterCols_;
+		const int col = cluster % clusterCols_;
+
+		computeEastBorder(cluster);
+		computeSouthBorder(cluster);
+		computeCorners(cluster);
+		// Borders are stored with the cluster to the north or west of them
+		if (col > 0) {
+			computeEastBorder(cluster - 1);
+		}
+		if (row > 0) {
+			computeSouthBorder(cluster - clusterCols_);
+			computeCorners(cluster - clusterCols_);
+			if (col > 0) {
+				computeCorners(cluster - clusterCols_ - 1);
+			}
+			if (col < clusterCols_ - 1) {
+				computeCorners(cluster - clusterCols_ + 1);
+			}
+		}
+	}
+
+	void HierarchicalPlanner::computeEastBorder(int cluster) {
+		std::vector<Transition>& transitions = eastBorders_[cluster];
+		transitions.clear();
+		if (cluster % clusterCols_ == clusterCols_ - 1) {
+			return;
+		}
+		const Cluster& first = clusters_[cluster];
+		const int firstBegin = map_.getIndex(first.row, first.col + first.cols - 1);
+		addBorderTransitions(transitions, firstBegin, firstBegin + 1, map_.getNumCols(), first.rows);
+	}
+
+	void HierarchicalPlanner::computeSouthBorder(int cluster) {
+		std::vector<Transition>& transitions = southBorders_[cluster];
+		transitions.clear();
+		if (cluster / clusterCols_ == clusterRows_ - 1) {
+			return;
+		}
+		const Cluster& first = clusters_[cluster];
+		const int firstBegin = map_.getIndex(first.row + first.rows - 1, first.col);
+		addBorderTransitions(transitions, firstBegin, firstBegin + map_.getNumCols(), 1, first.cols);
+	}
+
+	void HierarchicalPlanner::computeCorners(int cluster) {
+		southEastCorners_[cluster].clear();
+		southWestCorners_[cluster].clear();
+		const int row = cluster / clusterCols_;
+		const int col = cluster % clusterCols_;
+		if (row == clusterRows_ - 1) {
+			return;
+		}
+
+		// A diagonal step across a corner only matters when neither cell beside it lets the robot go around
+		const Cluster& first = clusters_[cluster];
+		const int lastRow = first.row + first.rows - 1;
+		if (col < clusterCols_ - 1) {
+			const int lastCol = first.col + first.cols - 1;
+			if (fits(lastRow, lastCol) && fits(lastRow + 1, lastCol + 1) && !fits(lastRow, lastCol + 1) && !fits(lastRow + 1, lastCol)) {
+				southEastCorners_[cluster].push_back(Transition{ map_.getIndex(lastRow, lastCol), map_.getIndex(lastRow + 1, lastCol + 1), NEIGHBOR_COST[0] });
+			}
+		}
+		if (col > 0) {
+			if (fits(lastRow, first.col) && fits(lastRow + 1, first.col - 1) && !fits(lastRow, first.col - 1) && !fits(lastRow + 1, first.col)) {
+				southWestCorners_[cluster].push_back(Transition{ map_.getIndex(lastRow, first.col), map_.getIndex(lastRow + 1, first.col - 1), NEIGHBOR_COST[0] });
+			}
+		}
+	}
+
+	void HierarchicalPlanner::addBorderTransitions(std::vector<Transition>& transitions, int firstBegin, int secondBegin, int step, int length) const {
+
+		// Straight crossings come in runs, one transition in the middle of a short run and one at each end of a long one
+		int begin = 0;
+		while (begin < length) {
+			if (!map_.robotFits(firstBegin + begin * step, robotRadius_) || !map_.robotFits(secondBegin + begin * step, robotRadius_)) {
+				++begin;
+				continue;
+			}
+			int end = begin + 1;
+			while (end < length && map_.robotFits(firstBegin + end * step, robotRadius_) && map_.robotFits(secondBegin + end * step, robotRadius_)) {
+				++end;
+			}
+			if (end - begin >= 6) {
+				transitions.push_back(Transition{ firstBegin + begin * step, secondBegin + begin * step, NEIGHBOR_COST[1] });
+				transitions.push_back(Transition{ firstBegin + (end - 1) * step, secondBegin + (end - 1) * step, NEIGHBOR_COST[1] });
+			}
+			else {
+				const int middle = begin + (end - begin) / 2;
+				transitions.push_back(Transition{ firstBegin + middle * step, secondBegin + middle * step, NEIGHBOR_COST[1] });
+			}
+			begin = end;
+		}
+
+		// Diagonal crossings the runs do not cover. Either end sitting next to a run can reach it along
+		// the border, so only those with no straight crossing beside them on both sides get a transition.
+		for (int offset = 0; offset < length; ++offset) {
+			const int first = firstBegin + offset * step;
+			if (!map_.robotFits(first, robotRadius_) || map_.robotFits(secondBegin + offset * step, robotRadius_)) {
+				continue;
+			}
+			for (int side = -1; side <= 1; side += 2) {
+				const int across = offset + side;
+				if (across < 0 || across >= length) {
+					continue;
+				}
+				if (map_.robotFits(secondBegin + across * step, robotRadius_) && !map_.robotFits(firstBegin + across * step, robotRadius_)) {
+					transitions.push_back(Transition{ first, secondBegin + across * step, NEIGHBOR_COST[0] });
+				}
+			}
+		}
+	}
+
+	void HierarchicalPlanner::deriveCluster(int index, bool recomputeDistances) {
+		Cluster& cluster = clusters_[index];
+		const int row = index / clusterCols_;
+		const int col = index % clusterCols_;
+
+		// Every transition touching the cluster, as (cell inside, cell across, cost)
+		struct Link {
+			int inside;
+			int across;
+			double cost;
+			bool operator<(const Link& other) const { return inside < other.inside; }
+		};
+		std::vector<Link> links;
+		const auto addFirst = [&links](const std::vector<Transition>& transitions) {
+			for (const Transition& t : transitions) { links.push_back(Link{ t.first, t.second, t.cost }); }
+		};
+		const auto addSecond = [&links](const std::vector<Transition>& transitions) {
+			for (const Transition& t : transitions) { links.push_back(Link{ t.second, t.first, t.cost }); }
+		};
+		addFirst(eastBorders_[index]);
+		addFirst(southBorders_[index]);
+		addFirst(southEastCorners_[index]);
+		addFirst(southWestCorners_[index]);
+		if (col > 0) {
+			addSecond(eastBorders_[index - 1]);
+		}
+		if (row > 0) {
+			addSecond(southBorders_[index - clusterCols_]);
+			if (col > 0) {
+				addSecond(southEastCorners_[index - clusterCols_ - 1]);
+			}
+			if (col < clusterCols_ - 1) {
+				addSecond(southWestCorners_[index - clusterCols_ + 1]);
+			}
+		}
+		std::stable_sort(links.begin(), links.end());
+
+		std::vector<int> entrances;
+		cluster.linkBegin.clear();
+		cluster.linkCells.clear();
+		cluster.linkCosts.clear();
+		for (const Link& link : links) {
+			if (entrances.empty() || entrances.back() != link.inside) {
+				entrances.push_back(link.inside);
+				cluster.linkBegin.push_back(static_cast<int>(cluster.linkCells.size()));
+			}
+			cluster.linkCells.push_back(link.across);
+			cluster.linkCosts.push_back(link.cost);
+		}
+		cluster.linkBegin.push_back(static_cast<int>(cluster.linkCells.size()));
+
+		if (!recomputeDistances && entrances == cluster.entrances) {
+			return;
+		}
+		cluster.entrances.swap(entrances);
+
+		// Entrance to entrance distances, one search over the cluster from each entrance
+		const size_t count = cluster.entrances.size();
+		cluster.distances.assign(count * count, UNREACHABLE);
+		ClusterSearch search(map_, robotRadius_, clusterSize_);
+		for (size_t from = 0; from < count; ++from) {
+			search.run(cluster.row, cluster.col, cluster.rows, cluster.cols, cluster.entrances[from], cluster.entrances);
+			for (size_t to = 0; to < count; ++to) {
+				cluster.distances[from * count + to] = search.distance(cluster.entrances[to]);
+			}
+		}
+	}
+
+	void HierarchicalPlanner::numberEntrances() {
+		entranceCells_.clear();
+		entranceClusters_.clear();
+		entranceNodes_.clear();
+		for (size_t i = 0; i < clusters_.size(); ++i) {
+			Cluster& cluster = clusters_[i];
+			cluster.firstNode = static_cast<int>(entranceCells_.size());
+			for (int cell : cluster.entrances) {
+				entranceCells_.push_back(cell);
+				entranceClusters_.push_back(static_cast<int>(i));
+				entranceNodes_.push_back(map_.getNode(cell));
+			}
+		}
+
+		// With every cluster numbered, resolve the node across each link once for all queries
+		for (Cluster& cluster : clusters_) {
+			cluster.linkNodes.resize(cluster.linkCells.size());
+			for (size_t link = 0; link < cluster.linkCells.size(); ++link) {
+				const int across = cluster.linkCells[link];
+				cluster.linkNodes[link] = entranceNode(clusterOf(across), across);
+			}
+		}
+	}
+
+	int HierarchicalPlanner::entranceNode(int cluster, int cell) const {
+		const std::vector<int>& entrances = clusters_[cluster].entrances;
+		return clusters_[cluster].firstNode + static_cast<int>(std::lower_bound(entrances.begin(), entrances.end(), cell) - entrances.begin());
+	}
+
+	PlanResult HierarchicalPlanner::plan(const Node& start, const Node& goal) {
+		return plan(start, goal, context_);
+	}
+
+	PlanResult HierarchicalPlanner::plan(const Node& startNode, const Node& goalNode, SearchContext& context) const {
+
+		PlanResult result;
+		result.suboptimality = 0.0;
+		if (!map_.isInside(startNode.getRow(), startNode.getCol())) {
+			result.status = PlanStatus::InvalidStart;
+			finishSearchStats(result);
+			return result;
+		}
+		if (!map_.isInside(goalNode.getRow(), goalNode.getCol())) {
+			result.status = PlanStatus::InvalidGoal;
+			finishSearchStats(result);
+			return result;
+		}
+		if (!isCurrent()) {
+			result.status = PlanStatus::Stale;
+			finishSearchStats(result);
+			return result;
+		}
+		if (!map_.robotFits(map_.getIndex(goalNode), robotRadius_)) {
+			result.status = PlanStatus::InvalidGoal;
+			finishSearchStats(result);
+			return result;
+		}
+
+		std::chrono::steady_clock::time_point searchStart = std::chrono::steady_clock::now();
+		const int startCell = map_.getIndex(startNode);
+		const int goalCell = map_.getIndex(goalNode);
+		const int startCluster = clusterOf(startCell);
+		const int goalCluster = clusterOf(goalCell);
+		const Cluster& first = clusters_[startCluster];
+		const Cluster& last = clusters_[goalCluster];
+		const bool startFits = map_.robotFits(startCell, robotRadius_);
+		ClusterSearch local(map_, robotRadius_, clusterSize_);
+
+		if (startCell == goalCell) {
+			result.status = PlanStatus::Found;
+			result.path.push_back(startNode);
+			result.expansions = 1;
+		}
+		else {
+
+			// Ends in the same or neighboring clusters are first joined directly, with a search
+			// confined to the clusters they span. Going through the entrances could cost much more.
+			std::vector<Node> directPath;
+			double directCost = UNREACHABLE;
+			if (std::abs(first.row - last.row) <= clusterSize_ && std::abs(first.col - last.col) <= clusterSize_) {
+				const int top = std::min(first.row, last.row);
+				const int left = std::min(first.col, last.col);
+				const int bottom = std::max(first.row + first.rows, last.row + last.rows);
+				const int right = std::max(first.col + first.cols, last.col + last.cols);
+				ClusterSearch direct(map_, robotRadius_, 2 * clusterSize_);
+				result.expansions += direct.run(top, left, bottom - top, right - left, startCell, goalCell);
+				directCost = direct.distance(goalCell);
+				if (directCost != UNREACHABLE) {
+					directPath.push_back(startNode);
+					direct.appendPath(goalCell, directPath);
+				}
+			}
+
+			// Nothing beats a path as long as the octile distance, any other may have to go around
+			// outside the clusters, through the entrances
+			if (directCost > octileDistance(map_, startCell, goalCell) + 1e-9) {
+
+				// Join the start to the entrances of its cluster and those of the goal's cluster to the goal.
+				// Steps between cells the robot fits on are symmetric, so a search from the goal gives both ways.
+				std::vector<double> startDistances(first.entrances.size());
+				result.expansions += local.run(first.row, first.col, first.rows, first.cols, startCell, first.entrances);
+				for (size_t i = 0; i < first.entrances.size(); ++i) {
+					startDistances[i] = local.distance(first.entrances[i]);
+				}
+				std::vector<double> goalDistances(last.entrances.size());
+				result.expansions += local.run(last.row, last.col, last.rows, last.cols, goalCell, last.entrances);
+				for (size_t i = 0; i < last.entrances.size(); ++i) {
+					goalDistances[i] = local.distance(last.entrances[i]);
+				}
+
+				// A* over the entrances, with the start and goal as two extra nodes
+				const int numEntrances = static_cast<int>(entranceCells_.size());
+				const int startId = numEntrances;
+				const int goalId = numEntrances + 1;
+				const unsigned generation = context.beginSearch(static_cast<size_t>(numEntrances) + 2, static_cast<size_t>(clusterRows_) + clusterCols_, TieBreak::LargerG);
+				SearchNode* nodes = context.getNodes();
+				OpenSet& openSet = context.getOpenSet();
+
+				const auto cellOf = [&](int id) { return id == startId ? startCell : id == goalId ? goalCell : entranceCells_[id]; };
+				const int goalRow = goalNode.getRow();
+				const int goalCol = goalNode.getCol();
+				const auto relax = [&](int id, double gScore, int parent) {
+					SearchNode& next = nodes[id];
+					const bool seen = next.generation == generation;
+					if (seen && (next.state == SearchState::Closed || gScore >= next.gScore)) {
+						return;
+					}
+					if (!seen) {
+						next.heuristic = id < numEntrances ? octile(entranceNodes_[id].getRow() - goalRow, entranceNodes_[id].getCol() - goalCol) : octileDistance(map_, cellOf(id), goalCell);
+					}
+					next.gScore = gScore;
+					next.f = gScore + next.heuristic;
+					next.parent = parent;
+					if (seen) {
+						openSet.decreaseKey(id);
+					}
+					else {
+						next.generation = generation;
+						next.state = SearchState::Open;
+						openSet.push(id);
+					}
+				};
+
+				relax(startId, 0.0, -1);
+				while (!openSet.empty()) {
+					const int current = openSet.pop();
+					++result.expansions;
+					nodes[current].state = SearchState::Closed;
+					if (current == goalId) {
+						break;
+					}
+
+					const double gScore = nodes[current].gScore;
+					if (current == startId) {
+						for (size_t i = 0; i < first.entrances.size(); ++i) {
+							if (startDistances[i] != UNREACHABLE) {
+								relax(first.firstNode + static_cast<int>(i), gScore + startDistances[i], current);
+							}
+						}
+						// A start the robot does not fit on has no transitions of its own, yet it may still step
+						// straight into a neighboring cluster, so join the entrances over there too
+						if (!startFits) {
+							const NeighborRange neighbors = map_.getNeighbors(startCell);
+							for (NeighborRange::iterator it = neighbors.begin(); it != neighbors.end(); ++it) {
+								const int neighbor = *it;
+								const int index = clusterOf(neighbor);
+								if (index == startCluster || !map_.robotFits(neighbor, robotRadius_)) {
+									continue;
+								}
+								const Cluster& cluster = clusters_[index];
+								result.expansions += local.run(cluster.row, cluster.col, cluster.rows, cluster.cols, neighbor, cluster.entrances);
+								for (size_t i = 0; i < cluster.entrances.size(); ++i) {
+									const double distance = local.distance(cluster.entrances[i]);
+									if (distance != UNREACHABLE) {
+										relax(cluster.firstNode + static_cast<int>(i), NEIGHBOR_COST[it.getDirection()] + distance, current);
+									}
+								}
+							}
+						}
+						continue;
+					}
+
+					const int index = entranceClusters_[current];
+					const Cluster& cluster = clusters_[index];
+					const size_t count = cluster.entrances.size();
+					const size_t i = static_cast<size_t>(current - cluster.firstNode);
+					for (size_t j = 0; j < count; ++j) {
+						const double distance = cluster.distances[i * count + j];
+						if (j != i && distance != UNREACHABLE) {
+							relax(cluster.firstNode + static_cast<int>(j), gScore + distance, current);
+						}
+					}
+					for (int link = cluster.linkBegin[i]; link < cluster.linkBegin[i + 1]; ++link) {
+						relax(cluster.linkNodes[link], gScore + cluster.linkCosts[link], current);
+					}
+					if (index == goalCluster && goalDistances[i] != UNREACHABLE) {
+						relax(goalId, gScore + goalDistances[i], current);
+					}
+				}
+
+				if (nodes[goalId].generation == generation && nodes[goalId].state == SearchState::Closed) {
+
+					// Abstract path from start to goal
+					std::vector<int> waypoints;
+					for (int id = goalId; id != -1; id = nodes[id].parent) {
+						waypoints.push_back(cellOf(id));
+					}
+					std::reverse(waypoints.begin(), waypoints.end());
+
+					// Refine every hop: a step across a border as it is, a hop inside a cluster with a search of that cluster
+					result.status = PlanStatus::Found;
+					result.path.push_back(startNode);
+					for (size_t i = 1; i < waypoints.size(); ++i) {
+						const int from = waypoints[i - 1];
+						const int to = waypoints[i];
+						if (from == to) {
+							continue;
+						}
+						const int fromCluster = clusterOf(from);
+						const int toCluster = clusterOf(to);
+						if (from == startCell && !startFits && fromCluster != toCluster) {
+							// The start stepped straight into the next cluster, find the step that led there
+							int bestStep = -1;
+							double bestCost = UNREACHABLE;
+							const Cluster& cluster = clusters_[toCluster];
+							const NeighborRange neighbors = map_.getNeighbors(startCell);
+							for (NeighborRange::iterator it = neighbors.begin(); it != neighbors.end(); ++it) {
+								if (clusterOf(*it) != toCluster || !map_.robotFits(*it, robotRadius_)) {
+									continue;
+								}
+								result.expansions += local.run(cluster.row, cluster.col, cluster.rows, cluster.cols, *it, to);
+								if (NEIGHBOR_COST[it.getDirection()] + local.distance(to) < bestCost) {
+									bestCost = NEIGHBOR_COST[it.getDirection()] + local.distance(to);
+									bestStep = *it;
+								}
+							}
+							result.expansions += local.run(cluster.row, cluster.col, cluster.rows, cluster.cols, bestStep, to);
+							result.cost += bestCost;
+							result.path.push_back(map_.getNode(bestStep));
+							local.appendPath(to, result.path);
+							continue;
+						}
+						if (fromCluster != toCluster) {
+							result.cost += (map_.getRow(from) != map_.getRow(to) && map_.getCol(from) != map_.getCol(to)) ? NEIGHBOR_COST[0] : NEIGHBOR_COST[1];
+							result.path.push_back(map_.getNode(to));
+							continue;
+						}
+						// A line is as short as a path between its ends gets and never leaves the cluster,
+						// only search when the robot does not fit all along it
+						const size_t lineStart = result.path.size();
+						if (traceLine(map_, robotRadius_, map_.getNode(from), map_.getNode(to), &result.path)) {
+							result.cost += octileDistance(map_, from, to);
+							continue;
+						}
+						result.path.resize(lineStart);
+						const Cluster& cluster = clusters_[fromCluster];
+						result.expansions += local.run(cluster.row, cluster.col, cluster.rows, cluster.cols, from, to);
+						result.cost += local.distance(to);
+						local.appendPath(to, result.path);
+					}
+
+					// The entrances bend the path where the best route would not, pull it straight again
+					result.cost = shortenPath(map_, robotRadius_, 2 * static_cast<size_t>(clusterSize_), result.path);
+				}
+			}
+
+			if (directCost != UNREACHABLE && (!result.found() || directCost <= result.cost)) {
+				result.status = PlanStatus::Found;
+				result.cost = directCost;
+				result.path.swap(directPath);
+			}
+		}
+
+		result.searchMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - searchStart).count();
+		finishSearchStats(result);
+		return result;
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "RobotPlanner.h"
+
+
+namespace RPP
+{
+	// Hierarchical path planning (HPA*, Botea, Mueller and Schaeffer) for maps too large to
+	// search cell by cell. The map is cut into square clusters. Where the robot can cross
+	// between two clusters, an entrance cell is placed on each side, and the distances between
+	// the entrances of a cluster are worked out once, inside the cluster. A query joins its start
+	// and goal to the entrances of their clusters, searches that small abstract graph and
+	// refines each hop of the result with a search confined to one cluster.
+	// Ends in the same or neighboring clusters are also joined by a direct search over the
+	// clusters they span, and the shorter of the two paths is kept. A path through the
+	// entrances is pulled straight afterwards, where lines of cells the robot fits on allow.
+	// Paths are not optimal: they cross clusters at entrance cells and take the best route
+	// within each cluster, not the best route overall, and pulling them straight only takes
+	// out part of the detour. Most come within a few percent of the shortest path, yet some
+	// are a third longer or more. There is no bound, so PlanResult::suboptimality is always 0.
+	// Unlike the Planner, the start may be a cell the robot does not fit on, the path then
+	// steps straight off it.
+	// The hierarchy is built for one robot radius. After obstacles change, hand the changed
+	// region to update() and only the clusters it touches and their neighbors are redone.
+	class HierarchicalPlanner
+	{
+	public:
+
+		HierarchicalPlanner(const Map& map, int robotRadius, int clusterSize = 32);
+
+		// Redoes the whole hierarchy
+		void rebuild();
+		// Redoes the clusters a map change touched, pass the DirtyRect of every change since the last call
+		void update(const DirtyRect& dirty);
+
+		// Plan with the planner's own context, one query at a time
+		PlanResult plan(const Node& start, const Node& goal);
+		// Plan with a caller owned context, safe to run concurrently with other contexts.
+		// The context is sized for the abstract graph, not the map.
+		PlanResult plan(const Node& start, const Node& goal, SearchContext& context) const;
+
+		// Getters
+		const Map& getMap() const { return map_; }
+		int getRobotRadius() const { return robotRadius_; }
+		int getClusterSize() const { return clusterSize_; }
+		int getNumClusters() const { return clusterRows_ * clusterCols_; }
+		int getNumEntrances() const { return static_cast<int>(entranceCells_.size()); }
+		// Wall time of the last rebuild() or update()
+		double getBuildMilliseconds() const { return buildMilliseconds_; }
+		// False once the map changed without an update()
+		bool isCurrent() const { return version_ == map_.getVersion(); }
+
+	private:
+
+		// A step between two clusters, from a cell of the first to a cell of the second
+		struct Transition {
+			int first;
+			int second;
+			double cost;
+		};
+
+		struct Cluster {
+			int row;						// Top left cell
+			int col;
+			int rows;
+			int cols;
+			std::vector<int> entrances;		// Entrance cells, sorted
+			std::vector<double> distances;	// Entrance to entrance inside the cluster, row-major, infinity when cut off
+			std::vector<int> linkBegin;		// Transitions of entrance i are links [linkBegin[i], linkBegin[i + 1])
+			std::vector<int> linkCells;		// Cell across the border
+			std::vector<double> linkCosts;
+			std::vector<int> linkNodes;		// Abstract node of the cell across, set by numberEntrances()
+			int firstNode;					// Abstract node number of the first entrance
+		};
+
+		const Map& map_;
+		int robotRadius_;
+		int clusterSize_;
+		int clusterRows_;
+		int clusterCols_;
+		std::vector<Cluster> clusters_;
+		// Transitions between cluster i and its neighbor to the east, south, south east and south west
+		std::vector<std::vector<Transition>> eastBorders_;
+		std::vector<std::vector<Transition>> southBorders_;
+		std::vector<std::vector<Transition>> southEastCorners_;
+		std::vector<std::vector<Transition>> southWestCorners_;
+		// Cell, cluster and position of every abstract node
+		std::vector<int> entranceCells_;
+		std::vector<int> entranceClusters_;
+		std::vector<Node> entranceNodes_;
+		unsigned version_;
+		double buildMilliseconds_;
+		SearchContext context_;
+
+		bool fits(int row, int col) const { return map_.isInside(row, col) && map_.robotFits(map_.getIndex(row, col), robotRadius_); }
+		int clusterOf(int cell) const { return (map_.getRow(cell) / clusterSize_) * clusterCols_ + map_.getCol(cell) / clusterSize_; }
+		int entranceNode(int cluster, int cell) const;
+
+		void computeEastBorder(int cluster);
+		void computeSouthBorder(int cluster);
+		void computeCorners(int cluster);
+		// Places transitions along a border, firstBegin and secondBegin are the first cells on either side
+		void addBorderTransitions(std::vector<Transition>& transitions, int firstBegin, int secondBegin, int step, int length) const;
+		// Redoes the borders a change inside the cluster can move
+		void computeBordersAround(int cluster);
+		// Collects the cluster's entrances and links from its borders, redoing the distances when the entrances moved
+		void deriveCluster(int cluster, bool recomputeDistances);
+		void numberEntrances();
+
+	};
+}
@@ -0,0 +1,302 @@
+#include "RobotIncremental.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+
+namespace RPP
+{
+	namespace
+	{
+		const double UNREACHABLE = std::numeric_limits<double>::infinity();
+
+		// Step costs with the diagonal rounded to a multiple of 2^-26. Distances and keys are then
+		// sums a double holds exactly, so keys that tie on paper tie in the queue too. Ties are
+		// common on a grid, and a cell left queued behind a rounding error goes stale right on
+		// the robot's path. Reported costs are still summed from NEIGHBOR_COST.
+		const double DIAGONAL_COST = std::floor(NEIGHBOR_COST[0] * 67108864.0 + 0.5) / 67108864.0;
+		const double STEP_COST[8] = { DIAGONAL_COST, 1.0, DIAGONAL_COST, 1.0, 1.0, DIAGONAL_COST, 1.0, DIAGONAL_COST };
+	}
+
+	IncrementalPlanner::IncrementalPlanner(const Map& map, int robotRadius)
+		:
+		map_(map),
+		robotRadius_(robotRadius),
+		position_(-1),
+		goal_(-1),
+		last_(-1),
+		keyModifier_(0.0),
+		vertices_(),
+		traversable_(),
+		version_(map.getVersion()),
+		queue_()
+	{}
+
+	void IncrementalPlanner::reset(const Node& start, const Node& goal) {
+
+		queue_.clear();
+		position_ = map_.isInside(start.getRow(), start.getCol()) ? map_.getIndex(start) : -1;
+		goal_ = map_.isInside(goal.getRow(), goal.getCol()) ? map_.getIndex(goal) : -1;
+		last_ = position_;
+		keyModifier_ = 0.0;
+
+		// Take a copy of the traversable bits so update() can tell which cells changed
+		const size_t cells = static_cast<size_t>(map_.getNumCells());
+		const std::uint64_t* current = map_.getTraversable(robotRadius_);
+		traversable_.assign(current, current + (cells + 63) / 64);
+		version_ = map_.getVersion();
+
+		Vertex unreached = { UNREACHABLE, UNREACHABLE, UNREACHABLE, UNREACHABLE, -1 };
+		vertices_.assign(cells, unreached);
+		queue_.setLess(KeyLess(vertices_.data()));
+		queue_.setSlot(KeySlot(vertices_.data()));
+
+		// The search grows from the goal, which is the one cell whose rhs is fixed
+		if (goal_ >= 0) {
+			vertices_[goal_].rhs = 0.0;
+			computeKey(goal_);
+			queue_.push(goal_);
+		}
+	}
+
+	void IncrementalPlanner::moveTo(const Node& position) {
+		if (!map_.isInside(position.getRow(), position.getCol())) {
+			position_ = -1;
+			return;
+		}
+
+		// Keys already queued were measured from the old position. Rather than redo them all,
+		// raise every key computed from now on by as much as the heuristic can have shrunk.
+		position_ = map_.getIndex(position);
+		if (last_ >= 0) {
+			keyModifier_ += distance(last_, position_);
+		}
+		last_ = position_;
+	}
+
+	void IncrementalPlanner::update(const DirtyRect& dirty) {
+
+		if (!dirty.isEmpty() && !vertices_.empty()) {
+			const std::uint64_t* current = map_.getTraversable(robotRadius_);
+			const int firstRow = std::max(dirty.minRow, 0);
+			const int lastRow = std::min(dirty.maxRow, map_.getNumRows() - 1);
+			const int firstCol = std::max(dirty.minCol, 0);
+			const int lastCol = std::min(dirty.maxCol, map_.getNumCols() - 1);
+
+			std::vector<int> changed;
+			for (int row = firstRow; row <= lastRow; ++row) {
+				for (int col = firstCol; col <= lastCol; ++col) {
+					const int cell = map_.getIndex(row, col);
+					if (isTraversable(current, cell) != passable(cell)) {
+						traversable_[cell >> 6] ^= std::uint64_t(1) << (cell & 63);
+						changed.push_back(cell);
+					}
+				}
+			}
+
+			// A cell that opened or closed changes the cost of every step into it, so the
+			// lookahead of its neighbors is redone. Its own rhs only depends on its neighbors.
+			for (int cell : changed) {
+				const NeighborRange neighbors = map_.getNeighbors(cell);
+				for (NeighborRange::iterator it = neighbors.begin(); it != neighbors.end(); ++it) {
+					const int neighbor = *it;
+					if (neighbor != goal_) {
+						vertices_[neighbor].rhs = lookahead(neighbor);
+						updateVertex(neighbor);
+					}
+				}
+			}
+		}
+
+		version_ = map_.getVersion();
+	}
+
+	PlanResult IncrementalPlanner::plan() {
+		return replan(nullptr);
+	}
+
+	PlanResult IncrementalPlanner::plan(SearchObserver& observer) {
+		return replan(&observer);
+	}
+
+	PlanResult IncrementalPlanner::replan(SearchObserver* observer) {
+
+		PlanResult result;
+		if (position_ < 0) {
+			result.status = PlanStatus::InvalidStart;
+			finishSearchStats(result);
+			return result;
+		}
+		if (goal_ < 0) {
+			result.status = PlanStatus::InvalidGoal;
+			finishSearchStats(result);
+			return result;
+		}
+		if (!isCurrent()) {
+			result.status = PlanStatus::Stale;
+			finishSearchStats(result);
+			return result;
+		}
+		if (!passable(goal_)) {
+			result.status = PlanStatus::InvalidGoal;
+			finishSearchStats(result);
+			return result;
+		}
+
+		std::chrono::steady_clock::time_point searchStart = std::chrono::steady_clock::now();
+		result.expansions = computeShortestPath(observer);
+
+		if (vertices_[position_].rhs != UNREACHABLE) {
+
+			// Walk down the distances to the goal, every step to the neighbor that gets there cheapest
+			result.status = PlanStatus::Found;
+			result.path.push_back(map_.getNode(position_));
+			int current = position_;
+			while (current != goal_) {
+				int best = -1;
+				int bestDirection = 0;
+				double bestCost = UNREACHABLE;
+				const NeighborRange neighbors = map_.getNeighbors(current);
+				for (NeighborRange::iterator it = neighbors.begin(); it != neighbors.end(); ++it) {
+					const int neighbor = *it;
+					if (passable(neighbor)) {
+						const double cost = STEP_COST[it.getDirection()] + vertices_[neighbor].g;
+						if (cost < bestCost) {
+							bestCost = cost;
+							best = neighbor;
+							bestDirection = it.getDirection();
+						}
+					}
+				}
+				if (best < 0 || result.path.size() > vertices_.size()) {
+					result.status = PlanStatus::NoPath;
+					result.path.clear();
+					result.cost = 0.0;
+					break;
+				}
+				result.cost += NEIGHBOR_COST[bestDirection];
+				result.path.push_back(map_.getNode(best));
+				current = best;
+			}
+		}
+
+		result.searchMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - searchStart).count();
+		finishSearchStats(result);
+		return result;
+	}
+
+	size_t IncrementalPlanner::computeShortestPath(SearchObserver* observer) {
+
+		size_t expansions = 0;
+		while (!queue_.empty()) {
+
+			// Done once nothing queued can lower the robot's distance and the robot's cell is settled
+			const Vertex& robot = vertices_[position_];
+			const double robotTie = std::min(robot.g, robot.rhs);
+			const double robotKey = robotTie + keyModifier_;
+			const int cell = queue_.top();
+			Vertex& vertex = vertices_[cell];
+			const bool below = vertex.key < robotKey || (vertex.key == robotKey && vertex.tie < robotTie);
+			if (!below && robot.rhs == robot.g) {
+				break;
+			}
+
+			++expansions;
+			if (observer) {
+				observer->nodeExpanded(cell);
+			}
+
+			// Keyed before the robot last moved, requeue with the current key first
+			const double oldKey = vertex.key;
+			const double oldTie = vertex.tie;
+			computeKey(cell);
+			if (oldKey < vertex.key || (oldKey == vertex.key && oldTie < vertex.tie)) {
+				queue_.update(cell);
+				continue;
+			}
+
+			const double oldG = vertex.g;
+			if (vertex.g > vertex.rhs) {
+				// Got closer to the goal, settle it and offer the shorter route to its neighbors
+				vertex.g = vertex.rhs;
+				queue_.remove(cell);
+			}
+			else {
+				// Got further away, drop it and redo the neighbors that went through it
+				vertex.g = UNREACHABLE;
+				updateVertex(cell);
+			}
+
+			// A cell the robot does not fit on is never stepped into, nobody's rhs depends on it
+			if (!passable(cell)) {
+				continue;
+			}
+			const NeighborRange neighbors = map_.getNeighbors(cell);
+			for (NeighborRange::iterator it = neighbors.begin(); it != neighbors.end(); ++it) {
+				const int neighbor = *it;
+				if (neighbor == goal_) {
+					continue;
+				}
+				Vertex& next = vertices_[neighbor];
+				const double throughCell = STEP_COST[it.getDirection()] + vertex.g;
+				if (vertex.g < oldG) {
+					if (throughCell >= next.rhs) {
+						continue;
+					}
+					next.rhs = throughCell;
+				}
+				else if (next.rhs == STEP_COST[it.getDirection()] + oldG) {
+					next.rhs = lookahead(neighbor);
+				}
+				else {
+					continue;
+				}
+				updateVertex(neighbor);
+			}
+		}
+		return expansions;
+	}
+
+	void IncrementalPlanner::updateVertex(int cell) {
+		Vertex& vertex = vertices_[cell];
+		if (vertex.g != vertex.rhs) {
+			computeKey(cell);
+			if (queue_.contains(cell)) {
+				queue_.update(cell);
+			}
+			else {
+				queue_.push(cell);
+			}
+		}
+		else if (queue_.contains(cell)) {
+			queue_.remove(cell);
+		}
+	}
+
+	void IncrementalPlanner::computeKey(int cell) {
+		Vertex& vertex = vertices_[cell];
+		vertex.tie = std::min(vertex.g, vertex.rhs);
+		vertex.key = vertex.tie + distance(position_, cell) + keyModifier_;
+	}
+
+	double IncrementalPlanner::lookahead(int cell) const {
+		double best = UNREACHABLE;
+		const NeighborRange neighbors = map_.getNeighbors(cell);
+		for (NeighborRange::iterator it = neighbors.begin(); it != neighbors.end(); ++it) {
+			const int neighbor = *it;
+			if (passable(neighbor)) {
+				best = std::min(best, STEP_COST[it.getDirection()] + vertices_[neighbor].g);
+			}
+		}
+		return best;
+	}
+
+	double IncrementalPlanner::distance(int from, int to) const {
+		const int rows = std::abs(map_.getRow(from) - map_.getRow(to));
+		const int cols = std::abs(map_.getCol(from) - map_.getCol(to));
+		const int diagonal = std::min(rows, cols);
+		return (std::max(rows, cols) - diagonal) + diagonal * DIAGONAL_COST;
+	}
+}
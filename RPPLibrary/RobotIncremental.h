@@ -0,0 +1,96 @@
+#pragma once
+#include "RobotPlanner.h"
+
+
+namespace RPP
+{
+	// Incremental replanning for a robot on a changing map (D* Lite, Koenig and Likhachev).
+	// The search runs from the goal towards the robot and is kept between calls. When the
+	// robot moves or obstacles change, plan() only repairs the cells whose distance to the goal
+	// the change affects, so a replan costs about as much as the change rather than the map.
+	// Paths are optimal and match the Planner's. Unlike the Planner, the robot may stand on a
+	// cell it does not fit on, say after an obstacle came down next to it: a move may leave
+	// such a cell but never enter one. The tree is built for one robot radius and one goal.
+	class IncrementalPlanner
+	{
+	public:
+
+		IncrementalPlanner(const Map& map, int robotRadius);
+
+		// Starts over for a new goal, dropping the tree of the old one
+		void reset(const Node& start, const Node& goal);
+		// The robot moved, the tree stays valid
+		void moveTo(const Node& position);
+		// Repairs the tree after map changes, pass the DirtyRect of every change since the last call
+		void update(const DirtyRect& dirty);
+
+		// Shortest path from the robot's position to the goal, repairing what changed since the last call
+		PlanResult plan();
+		// Same, reporting every expansion to the observer
+		PlanResult plan(SearchObserver& observer);
+
+		// Getters
+		const Map& getMap() const { return map_; }
+		int getRobotRadius() const { return robotRadius_; }
+		Node getPosition() const { return position_ < 0 ? Node() : map_.getNode(position_); }
+		Node getGoal() const { return goal_ < 0 ? Node() : map_.getNode(goal_); }
+		// False once the map changed without an update()
+		bool isCurrent() const { return version_ == map_.getVersion(); }
+
+	private:
+
+		struct Vertex {
+			double g;			// Distance to the goal as of the last expansion
+			double rhs;			// One step lookahead of g, the vertex is queued while they differ
+			double key;			// Queue key, min(g, rhs) plus the heuristic
+			double tie;			// Second key component, min(g, rhs)
+			int heapIndex;		// Slot in the queue, -1 when not queued
+		};
+
+		// Orders queued cells by key, then by the second component
+		struct KeyLess {
+			const Vertex* vertices;
+
+			KeyLess(const Vertex* v = nullptr) : vertices(v) {}
+
+			bool operator()(int a, int b) const {
+				if (vertices[a].key != vertices[b].key) {
+					return vertices[a].key < vertices[b].key;
+				}
+				return vertices[a].tie < vertices[b].tie;
+			}
+		};
+
+		struct KeySlot {
+			Vertex* vertices;
+
+			KeySlot(Vertex* v = nullptr) : vertices(v) {}
+
+			int get(int cell) const { return vertices[cell].heapIndex; }
+			void set(int cell, int slot) const { vertices[cell].heapIndex = slot; }
+		};
+
+		const Map& map_;
+		int robotRadius_;
+		int position_;						// Robot cell, -1 when off the map
+		int goal_;							// Goal cell, -1 when off the map
+		int last_;							// Robot cell the queue keys were last corrected for
+		double keyModifier_;				// Sum of the heuristic moves of the robot since reset()
+		std::vector<Vertex> vertices_;
+		std::vector<std::uint64_t> traversable_;	// Traversable bits the tree was built on
+		unsigned version_;
+		IndexedHeap<int, KeyLess, KeySlot> queue_;
+
+		bool passable(int cell) const { return isTraversable(traversable_.data(), cell); }
+		// Octile distance, consistent with the step costs
+		double distance(int from, int to) const;
+		void computeKey(int cell);
+		// Best step cost plus g over the cells reachable from the cell
+		double lookahead(int cell) const;
+		// Requeues, reorders or unqueues the cell after its g or rhs changed
+		void updateVertex(int cell);
+		size_t computeShortestPath(SearchObserver* observer);
+		PlanResult replan(SearchObserver* observer);
+
+	};
+}
@@ -0,0 +1,79 @@
+#include "RobotInflation.h"
+#include "RobotSimd.h"
+#include <algorithm>
+#include <climits>
+
+namespace RPP
+{
+    // Clears bits [first, last)
+    static void clearBits(std::uint64_t* bits, size_t first, size_t last) {
+        for (; first < last && (first & 63) != 0; ++first) {
+            bits[first >> 6] &= ~(std::uint64_t(1) << (first & 63));
+        }
+        for (; first + 64 <= last; first += 64) {
+            bits[first >> 6] = 0;
+        }
+        for (; first < last; ++first) {
+            bits[first >> 6] &= ~(std::uint64_t(1) << (first & 63));
+        }
+    }
+
+    const std::uint64_t* InflationCache::get(const int* clearance, int numRows, int numCols, int robotRadius, unsigned version) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        Layer* layer = nullptr;
+        for (const std::unique_ptr<Layer>& candidate : layers_) {
+            if (candidate->radius == robotRadius) {
+                layer = candidate.get();
+                break;
+            }
+        }
+        if (layer == nullptr) {
+            layers_.emplace_back(new Layer());
+            layer = layers_.back().get();
+            layer->radius = robotRadius;
+        }
+        else if (layer->version == version) {
+            return layer->bits.data();
+        }
+
+        // Missing or built for an older map, the stale buffer is reused
+        build(clearance, numRows, numCols, robotRadius, layer->bits);
+        layer->version = version;
+        return layer->bits.data();
+    }
+
+    void InflationCache::clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        layers_.clear();
+    }
+
+    void InflationCache::build(const int* clearance, int numRows, int numCols, int robotRadius, std::vector<std::uint64_t>& bits) {
+        const size_t cells = static_cast<size_t>(numRows) * numCols;
+        bits.assign((cells + 63) / 64, 0);
+
+        // Clearance never goes past INT_MAX, so no cell clears a radius that large
+        const long long radiusSquared = static_cast<long long>(robotRadius) * robotRadius;
+        if (radiusSquared >= INT_MAX) {
+            return;
+        }
+        getGridKernels().thresholdBits(clearance, cells, static_cast<int>(radiusSquared), bits.data());
+
+        // The footprint has to stay on the map, so a border as wide as the radius is cleared again
+        const int margin = std::max(robotRadius, 0);
+        if (margin == 0) {
+            return;
+        }
+        if (2 * margin >= numRows || 2 * margin >= numCols) {
+            std::fill(bits.begin(), bits.end(), 0);
+            return;
+        }
+        // Each clear runs from the right border of a row through the left border of the next
+        clearBits(bits.data(), 0, static_cast<size_t>(margin) * numCols + margin);
+        for (int row = margin; row < numRows - margin; ++row) {
+            const size_t offset = static_cast<size_t>(row) * numCols;
+            clearBits(bits.data(), offset + numCols - margin, offset + numCols + margin);
+        }
+        clearBits(bits.data(), static_cast<size_t>(numRows - margin) * numCols, cells);
+    }
+}
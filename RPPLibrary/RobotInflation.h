@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace RPP
+{
+    // Bit of a traversability layer, set where the robot fits.
+    inline bool isTraversable(const std::uint64_t* layer, int index) {
+        return (layer[index >> 6] >> (index & 63)) & 1;
+    }
+
+    // Configuration space layers of a map, one bit per cell and robot radius. A bit is set
+    // when a robot of that radius centered on the cell clears every obstacle and stays on
+    // the map, so the footprint test of a search becomes a single bit lookup.
+    // Layers are built from the clearance layer on first use and kept until the map version
+    // moves on, so robots of a few sizes sharing a map each pay for their inflation once.
+    // Lookups are serialized on a mutex and may come from concurrent searches.
+    class InflationCache {
+
+        public:
+
+            InflationCache()
+                :
+                mutex_(),
+                layers_()
+            {}
+
+            // Copies start out empty, their layers are rebuilt on demand
+            InflationCache(const InflationCache&)
+                :
+                mutex_(),
+                layers_()
+            {}
+            InflationCache& operator=(const InflationCache&) { clear(); return *this; }
+
+            // Layer of the radius for this map version, building it when missing or stale.
+            // Stays valid until the map changes.
+            const std::uint64_t* get(const int* clearance, int numRows, int numCols, int robotRadius, unsigned version);
+            void clear();
+
+        private:
+
+            struct Layer {
+                int radius;
+                unsigned version;
+                std::vector<std::uint64_t> bits;
+            };
+
+            std::mutex mutex_;
+            std::vector<std::unique_ptr<Layer>> layers_;
+
+            static void build(const int* clearance, int numRows, int numCols, int robotRadius, std::vector<std::uint64_t>& bits);
+
+    };
+}
@@ -0,0 +1,190 @@
+#include "RobotPlanner.h"
+#include <algorithm>
+#include <cstdlib>
+
+
+namespace RPP
+{
+	// Jump Point Search (Harabor and Grastien) on the same graph the A* engine searches:
+	// eight directions, Euclidean step costs and diagonal steps that may cut past a blocked
+	// corner, since a step only asks that the robot fits on the cell it lands on.
+	// Runs of cells that any optimal path could cross in several equally long orders are
+	// skipped in one scan, only the cells where a path may have to turn are queued.
+
+	int Planner::jump(const SearchInput& input, int row, int col, int rowStep, int colStep) const {
+
+		for (;;) {
+			if (!walkable(input, row, col)) {
+				return -1;
+			}
+			const int cell = map_.getIndex(row, col);
+			if (cell == input.goal) {
+				return cell;
+			}
+
+			if (rowStep != 0 && colStep != 0) {
+				// A wall beside the diagonal opens a turn that is shorter through this cell
+				if ((walkable(input, row + rowStep, col - colStep) && !walkable(input, row, col - colStep)) ||
+					(walkable(input, row - rowStep, col + colStep) && !walkable(input, row - rowStep, col))) {
+					return cell;
+				}
+				// So does any jump point the straight scans from here run into
+				if (jump(input, row, col + colStep, 0, colStep) != -1 || jump(input, row + rowStep, col, rowStep, 0) != -1) {
+					return cell;
+				}
+			}
+			else if (colStep != 0) {
+				if ((walkable(input, row + 1, col + colStep) && !walkable(input, row + 1, col)) ||
+					(walkable(input, row - 1, col + colStep) && !walkable(input, row - 1, col))) {
+					return cell;
+				}
+			}
+			else {
+				if ((walkable(input, row + rowStep, col + 1) && !walkable(input, row, col + 1)) ||
+					(walkable(input, row + rowStep, col - 1) && !walkable(input, row, col - 1))) {
+					return cell;
+				}
+			}
+
+			row += rowStep;
+			col += colStep;
+		}
+	}
+
+	void Planner::jumpPointSearch(const SearchInput& input, SearchContext& context, PlanResult& result) const {
+
+		const unsigned generation = context.beginSearch(map_, input.tieBreak);
+		SearchNode* nodes = context.getNodes();
+		result.suboptimality = input.weight;
+		OpenSet& openSet = context.getOpenSet();
+
+		SearchNode& start = nodes[input.start];
+		start.heuristic = input.heuristic->estimate(input.start);
+		start.gScore = 0;
+		start.f = 0;
+		start.parent = -1;
+		start.generation = generation;
+		start.state = SearchState::Open;
+		openSet.push(input.start);
+		if (input.observer) {
+			input.observer->nodeOpened(input.start);
+		}
+		RPP_STATS(result.stats.generated = 1, result.stats.peakOpenSize = 1);
+
+		while (!openSet.empty()) {
+
+			if (outOfBudget(input, result.expansions)) {
+				result.status = PlanStatus::TimedOut;
+				break;
+			}
+
+			const int current = openSet.pop();
+			++result.expansions;
+			if (input.observer) {
+				input.observer->nodeExpanded(current);
+			}
+			nodes[current].state = SearchState::Closed;
+
+			if (current == input.goal) {
+				tracePath(nodes, current, result);
+				break;
+			}
+
+			const int row = map_.getRow(current);
+			const int col = map_.getCol(current);
+
+			// Directions worth scanning: all eight from the start, otherwise the natural
+			// continuations of the way we came plus the turns a wall forces
+			int rowSteps[8];
+			int colSteps[8];
+			int count = 0;
+			const int parent = nodes[current].parent;
+			if (parent == -1) {
+				for (int direction = 0; direction < 8; ++direction) {
+					rowSteps[count] = NEIGHBOR_ROW[direction];
+					colSteps[count] = NEIGHBOR_COL[direction];
+					++count;
+				}
+			}
+			else {
+				const int rowStep = (row > map_.getRow(parent)) - (row < map_.getRow(parent));
+				const int colStep = (col > map_.getCol(parent)) - (col < map_.getCol(parent));
+				if (rowStep != 0 && colStep != 0) {
+					rowSteps[count] = rowStep; colSteps[count] = 0; ++count;
+					rowSteps[count] = 0; colSteps[count] = colStep; ++count;
+					rowSteps[count] = rowStep; colSteps[count] = colStep; ++count;
+					if (!walkable(input, row, col - colStep)) {
+						rowSteps[count] = rowStep; colSteps[count] = -colStep; ++count;
+					}
+					if (!walkable(input, row - rowStep, col)) {
+						rowSteps[count] = -rowStep; colSteps[count] = colStep; ++count;
+					}
+				}
+				else if (colStep != 0) {
+					rowSteps[count] = 0; colSteps[count] = colStep; ++count;
+					if (!walkable(input, row + 1, col)) {
+						rowSteps[count] = 1; colSteps[count] = colStep; ++count;
+					}
+					if (!walkable(input, row - 1, col)) {
+						rowSteps[count] = -1; colSteps[count] = colStep; ++count;
+					}
+				}
+				else {
+					rowSteps[count] = rowStep; colSteps[count] = 0; ++count;
+					if (!walkable(input, row, col + 1)) {
+						rowSteps[count] = rowStep; colSteps[count] = 1; ++count;
+					}
+					if (!walkable(input, row, col - 1)) {
+						rowSteps[count] = rowStep; colSteps[count] = -1; ++count;
+					}
+				}
+			}
+
+			const double currentG = nodes[current].gScore;
+			for (int i = 0; i < count; ++i) {
+
+				const int successor = jump(input, row + rowSteps[i], col + colSteps[i], rowSteps[i], colSteps[i]);
+				if (successor == -1) {
+					continue;
+				}
+
+				SearchNode& next = nodes[successor];
+				const SearchState state = next.generation == generation ? next.state : SearchState::Unvisited;
+				if (state == SearchState::Closed) {
+					continue;
+				}
+				if (state == SearchState::Unvisited) {
+					next.heuristic = input.heuristic->estimate(successor);
+					if (next.heuristic == HEURISTIC_MAX) {
+						continue;
+					}
+				}
+
+				// The jump ran along one line, so its length is the step count times the step cost
+				const int steps = std::max(std::abs(map_.getRow(successor) - row), std::abs(map_.getCol(successor) - col));
+				const double stepCost = (rowSteps[i] != 0 && colSteps[i] != 0) ? NEIGHBOR_COST[0] : NEIGHBOR_COST[1];
+				const double tentativeGScore = currentG + steps * stepCost;
+
+				if (state == SearchState::Unvisited) {
+					next.generation = generation;
+					next.state = SearchState::Open;
+					next.gScore = tentativeGScore;
+					next.f = next.gScore + input.weight * next.heuristic;
+					next.parent = current;
+					openSet.push(successor);
+					if (input.observer) {
+						input.observer->nodeOpened(successor);
+					}
+					RPP_STATS(++result.stats.generated, result.stats.peakOpenSize = std::max(result.stats.peakOpenSize, openSet.size()));
+				}
+				else if (tentativeGScore < next.gScore) {
+					next.gScore = tentativeGScore;
+					next.f = next.gScore + input.weight * next.heuristic;
+					next.parent = current;
+					openSet.decreaseKey(successor);
+					RPP_STATS(++result.stats.decreaseKeys);
+				}
+			}
+		}
+	}
+}
@@ -1,15 +1,71 @@
 #include "RobotMap.h"
 #include <iostream>
-#include <iomanip>
 #include <queue>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 
 namespace RPP
 {
-    
+    namespace
+    {
+        // Calls visit(row, firstCol, lastCol) for each row of the cells within the obstacle's radius
+        // of its center that are on the map. A cell is in when dx * dx + dy * dy <= radius * radius,
+        // the half width of each row is found by walking it in from the widest row, no square roots.
+        template <typename Visit>
+        void forEachSpan(const Obstacle& obstacle, int numRows, int numCols, Visit visit) {
+            const int centerRow = obstacle.getObstacleCenterNode().getRow();
+            const int centerCol = obstacle.getObstacleCenterNode().getCol();
+            const std::int64_t radius = obstacle.getObstacleRadius();
+            std::int64_t halfWidth = radius;
+            for (std::int64_t dy = 0; dy <= radius; ++dy) {
+                while (halfWidth * halfWidth + dy * dy > radius * radius) {
+                    --halfWidth;
+                }
+                const int firstCol = static_cast<int>(std::max<std::int64_t>(centerCol - halfWidth, 0));
+                const int lastCol = static_cast<int>(std::min<std::int64_t>(centerCol + halfWidth, numCols - 1));
+                if (firstCol > lastCol) {
+                    continue;
+                }
+                const std::int64_t above = centerRow - dy;
+                const std::int64_t below = centerRow + dy;
+                if (above >= 0 && above < numRows) {
+                    visit(static_cast<int>(above), firstCol, lastCol);
+                }
+                if (dy != 0 && below >= 0 && below < numRows) {
+                    visit(static_cast<int>(below), firstCol, lastCol);
+                }
+            }
+        }
+
+        // Position of the lowest set bit, bits must not be zero
+        int lowestBit(std::uint64_t bits) {
+#if defined(_MSC_VER) && defined(_M_X64)
+            unsigned long position;
+            _BitScanForward64(&position, bits);
+            return static_cast<int>(position);
+#elif defined(__GNUC__)
+            return __builtin_ctzll(bits);
+#else
+            int position = 0;
+            while (!(bits & 1)) {
+                bits >>= 1;
+                ++position;
+            }
+            return position;
+#endif
+        }
+    }
+
     Obstacle Obstacle::createObstacle(int x, int y, int radius) 
     {
         // Do some validation 
@@ -23,264 +79,371 @@ namespace RPP
         return obstacle;
     }
     
-    Map::Map(int numRows, int numCols) : numRows_(numRows), numCols_(numCols) 
+    Map::Map(int numRows, int numCols) : numRows_(numRows), numCols_(numCols), occupancy_(nullptr), clearance_(nullptr), distanceMetric_(DistanceMetric::Euclidean), version_(0)
     {
         if (numRows <= 0 || numCols <= 0) {
             throw std::invalid_argument("Matrix size can not be negative or zero");
         }
-        grid_.reserve(numRows);
-        for (int row = 0; row < numRows_; ++row) {
-            grid_.emplace_back();
-            grid_.back().reserve(numCols);
-            for (int col = 0; col < numCols_; ++col) {
-                grid_.back().emplace_back(row, col);
-            }
+        allocateLayers();
+        setNeighborOffsets();
+    }
+
+    Map::Map(const Map& other)
+        :
+        numRows_(other.numRows_),
+        numCols_(other.numCols_),
+        occupancy_(nullptr),
+        clearance_(nullptr),
+        occupancyStorage_(other.occupancyStorage_),
+        clearanceStorage_(other.clearanceStorage_),
+        mappedFile_(),
+        nearest_(other.nearest_),
+        flags_(other.flags_),
+        obstaclesList_(other.obstaclesList_),
+        neighborOffsets_(),
+        distanceMetric_(other.distanceMetric_),
+        distanceTransform_(),
+        version_(other.version_),
+        inflation_()
+    {
+        // Mapped pages are shared with the original, the copy gets layers of its own
+        if (other.mappedFile_) {
+            const size_t cells = static_cast<size_t>(numRows_) * numCols_;
+            occupancyStorage_.assign(other.occupancy_, other.occupancy_ + (cells + 63) / 64);
+            clearanceStorage_.assign(other.clearance_, other.clearance_ + cells);
         }
-        setNeighbors(); // set neighbors for each node
+        occupancy_ = occupancyStorage_.data();
+        clearance_ = clearanceStorage_.data();
+        setNeighborOffsets();
     }
 
-    void Map::setNeighbors() {
-        for (int row = 0; row < numRows_; ++row) {
-            for (int col = 0; col < numCols_; ++col) {
-                Node* node = &grid_[row][col];
-                for (int r = -1; r <= 1; ++r) {
-                    for (int c = -1; c <= 1; ++c) {
-                        if (r == 0 && c == 0) {
-                            continue; // Skip the current node
-                        }
-                        int nrow = row + r;
-                        int ncol = col + c;
-                        if (nrow >= 0 && nrow < numRows_  && ncol >= 0 && ncol < numCols_ ) {
-                            node->getNeighbors().push_back(&grid_[nrow][ncol]);
-                        }
-                    }
+    Map& Map::operator=(const Map& other) {
+        if (this != &other) {
+            *this = Map(other);
+        }
+        return *this;
+    }
+
+    void Map::allocateLayers() {
+        const size_t cells = static_cast<size_t>(numRows_) * numCols_;
+        occupancyStorage_.assign((cells + 63) / 64, 0);
+        clearanceStorage_.assign(cells, INT_MAX);
+        mappedFile_.reset();
+        occupancy_ = occupancyStorage_.data();
+        clearance_ = clearanceStorage_.data();
+        flags_.clear();
+    }
+
+    void Map::setNeighborOffsets() {
+        int direction = 0;
+        for (int r = -1; r <= 1; ++r) {
+            for (int c = -1; c <= 1; ++c) {
+                if (r == 0 && c == 0) {
+                    continue; // Skip the current node
                 }
+                neighborOffsets_[direction++] = r * numCols_ + c;
             }
         }
     }
-  
+
+    NeighborRange Map::getNeighbors(int index) const {
+        // Directions in offset order: 0 1 2 / 3 . 4 / 5 6 7
+        const int row = getRow(index);
+        const int col = index - row * numCols_;
+        unsigned mask = 0xFF;
+        if (row == 0) {
+            mask &= ~0x07u;
+        }
+        if (row == numRows_ - 1) {
+            mask &= ~0xE0u;
+        }
+        if (col == 0) {
+            mask &= ~0x29u;
+        }
+        if (col == numCols_ - 1) {
+            mask &= ~0x94u;
+        }
+        return NeighborRange(index, neighborOffsets_, mask);
+    }
+
     void Map::createObstacle(int x, int y, int radius)
     {
-        bool partial = false;
-        // Validate obstacles that are fully out of bounds
-        for (int row = x - radius; row <= x + radius; ++row) {
-            for (int col = y - radius; col <= y + radius; ++col) {
-                if (row >= 0 && row < numRows_ && col >= 0 && col < numCols_) {
-                    double dx = row - x;
-                    double dy = col - y;
-                    double distance = std::sqrt(dx * dx + dy * dy);
-                    if (distance <= radius) {
-                        // If we enter this if statement that means obstacle is at least partially bounds.
-                        // Create obstacle and add it to the list
-                        Obstacle obstacle = Obstacle::createObstacle(x, y, radius);
-                        obstaclesList_.push_back(obstacle);
-                        return;
-                    }
-                }
-            }
+        Obstacle obstacle = Obstacle::createObstacle(x, y, radius);
+        if (!touchesMap(obstacle)) {
+            throw std::invalid_argument("Obstacle at position at (" + std::to_string(x) + "," + std::to_string(y) + ") will be fully outside the map boundaries");
         }
+        obstaclesList_.push_back(obstacle);
+    }
 
-        // at this point not part of the obstacle is in the map so we cna throw an invalid argument.
-        throw std::invalid_argument("Obstacle at position at (" + std::to_string(x) + "," + std::to_string(y) + ") will be fully outside the map boundaries");
-        
+    bool Map::touchesMap(const Obstacle& obstacle) const {
+        // The map cell closest to the center is the one that decides, no need to look at the others
+        const Node center = obstacle.getObstacleCenterNode();
+        const std::int64_t dx = center.getRow() - std::max(0, std::min(center.getRow(), numRows_ - 1));
+        const std::int64_t dy = center.getCol() - std::max(0, std::min(center.getCol(), numCols_ - 1));
+        const std::int64_t radius = obstacle.getObstacleRadius();
+        return dx * dx + dy * dy <= radius * radius;
     }
 
     void Map::addObstaclesToMap(const std::vector<Obstacle>& obstaclesList) {
         for (const Obstacle& obstacle : obstaclesList) {
-            Node center = obstacle.getObstacleCenterNode();
-            int radius = obstacle.getObstacleRadius();
-            for (int row = center.getRow() - radius; row <= center.getRow() + radius; ++row) {
-                for (int col = center.getCol() - radius; col <= center.getCol() + radius; ++col) {
-                    if (row < 0 || col < 0 || row >= numRows_ || col >= numCols_) {
-                        // Skip cells outside the map bounds
-                        continue;
-                    }
-                    Node& node = grid_[row][col];
-                    if (node.isObstacle()) {
-                        // Skip cells already marked as obstacles
-                        continue;
-                    }
-                    double dx = row - center.getRow();
-                    double dy = col - center.getCol();
-                    double distance = std::sqrt(dx * dx + dy * dy);
-                    if (distance <= radius) {
-                        node.setObstacle(true);
-                        node.setDistance(0);
-                        
-                    }
-                }
-            }
+            stampObstacle(obstacle, nullptr);
         }
+        computeClearance();
+    }
 
-        // Run untill all nodes have values
-        bool changed = true;
-        while (changed) {
-            changed = false;
-            for (int row = 0; row < numRows_; ++row) {
-                for (int col = 0; col < numCols_; ++col) {
-                    Node* node = &grid_[row][col];
-                    int minDistance = INT_MAX;
-                    for (Node* neighbor : node->getNeighbors()) {
-                        // print neighbors
-                        //std::cout << "Neighbor row: " << neighbor->getRow() << " col: " << neighbor->getCol() << std::endl;
-                        if (!neighbor->isObstacle() && neighbor->getDistance() != INT_MAX) {
-                            int distance = neighbor->getDistance() + 1;
-                            if (distance < minDistance && node->getDistance() > distance) {
-                                minDistance = distance;
-                                //std::cout << "1 Setting : Node row: " << node->getRow() << " col: " << node->getCol() << " set to " << minDistance << std::endl;
-                            }
-                        }
-                        else if (neighbor->isObstacle() && node->getDistance() != 1 && node->getDistance() != 0) {
-                           minDistance = 1;
-                           //std::cout << "2 Setting : Node row: " << node->getRow() << " col: " << node->getCol() << " set to " << minDistance << std::endl;
-                        }
-                    }
-                    if (minDistance != INT_MAX) {
-                        //std::cout << "Node Distance was at " << node->getDistance() << std::endl;
-                        //std::cout << "3 Setting : Node row: " << node->getRow() << " col: " << node->getCol() << " set to " << minDistance << std::endl;
-                        
-                        node->setDistance(minDistance);
-                        changed = true;
-                    }
-                }
+    DirtyRect Map::addObstacles(const std::vector<Obstacle>& obstacles) {
+        // Check them all first so a bad one leaves the map as it was
+        for (const Obstacle& obstacle : obstacles) {
+            const Node center = obstacle.getObstacleCenterNode();
+            Obstacle::createObstacle(center.getRow(), center.getCol(), obstacle.getObstacleRadius());
+            if (!touchesMap(obstacle)) {
+                throw std::invalid_argument("Obstacle at position at (" + std::to_string(center.getRow()) + "," + std::to_string(center.getCol()) + ") will be fully outside the map boundaries");
             }
         }
+
+        std::vector<int> added;
+        for (const Obstacle& obstacle : obstacles) {
+            obstaclesList_.push_back(obstacle);
+            stampObstacle(obstacle, &added);
+        }
+
+        DirtyRect dirty;
+        if (added.empty()) {
+            return dirty;
+        }
+        if (added.size() > static_cast<size_t>(getNumCells()) / 16) {
+            // Past a few percent of the map the local repair costs more than starting over
+            computeClearance();
+            dirty.include(0, 0);
+            dirty.include(numRows_ - 1, numCols_ - 1);
+        }
+        else {
+            repairClearance(added, std::vector<int>(), dirty);
+        }
+        return dirty;
     }
 
-    void Map::printToConsole(bool showBinary) const
-    {
-        if (showBinary) 
-        {
-            // Print the binary map
-            std::cout << "Binary Map:" << std::endl;
-            for (int row = 0; row < numRows_; ++row) {
-                std::cout << std::setw(2) << row << "| ";
-                for (int col = 0; col < numCols_; ++col) {
-                    if (grid_[row][col].isObstacle()) {
-                        std::cout << "\033[31m"; // red
-                        std::cout << std::setw(6) << " 1  ";
-                    }
-                    else if (grid_[row][col].isStart()) {
-                            std::cout << "\033[34m"; // blue
-                            std::cout << std::setw(6) << " 0  ";
-                    }
-                    else if (grid_[row][col].isEnd()) {
-                            std::cout << "\033[32m"; // green
-                            std::cout << std::setw(6) << " 0  ";
-                    }
-                    else if (grid_[row][col].isRobot()) {
-                        std::cout << "\033[33m"; // Yellow
-                        std::cout << std::setw(6) << " 1  ";
-                    }
-                    else if (grid_[row][col].isBestPath()) {
-                        std::cout << "\033[35m"; // Magenta
-                        std::cout << std::setw(6) << " 0  ";
-                    }
-                    else if (grid_[row][col].isPath()) {
-                        std::cout << "\033[36m"; // Cyan
-                        std::cout << std::setw(6) << " 0  ";
-                    }
-                    else {
-                            std::cout << "\033[0m";
-                            std::cout << std::setw(6) << " 0  ";
+    void Map::computeClearance() {
+        distanceTransform_.compute(occupancy_, numRows_, numCols_, distanceMetric_, clearance_, nearest_.empty() ? nullptr : nearest_.data());
+        ++version_;
+    }
+
+    void Map::stampObstacle(const Obstacle& obstacle, std::vector<int>* added) {
+        forEachSpan(obstacle, numRows_, numCols_, [this, added](int row, int firstCol, int lastCol) {
+            // Whole words at a time, only the words at either end of the span are masked
+            const int first = getIndex(row, firstCol);
+            const int last = getIndex(row, lastCol);
+            const int lastWord = last >> 6;
+            for (int word = first >> 6; word <= lastWord; ++word) {
+                std::uint64_t mask = ~std::uint64_t(0);
+                if (word == first >> 6) {
+                    mask &= ~std::uint64_t(0) << (first & 63);
+                }
+                if (word == lastWord) {
+                    mask &= ~std::uint64_t(0) >> (63 - (last & 63));
+                }
+                std::uint64_t fresh = mask & ~occupancy_[word];
+                occupancy_[word] |= mask;
+                if (added != nullptr) {
+                    for (; fresh != 0; fresh &= fresh - 1) {
+                        added->push_back((word << 6) + lowestBit(fresh));
                     }
                 }
-                std::cout << "\033[0m";
-                std::cout << std::endl;
             }
+        });
+    }
 
-            // Print the column numbers
-            std::cout << "  +";
-            for (int c = 0; c < numCols_; ++c) {
-                std::cout << "   ---";
+    void Map::obstacleCells(const Obstacle& obstacle, std::vector<int>& cells) const {
+        forEachSpan(obstacle, numRows_, numCols_, [this, &cells](int row, int firstCol, int lastCol) {
+            for (int index = getIndex(row, firstCol), last = getIndex(row, lastCol); index <= last; ++index) {
+                cells.push_back(index);
             }
-            std::cout << std::endl << "  ";
-            for (int c = 0; c < numCols_; ++c) {
-                std::cout << std::setw(6) << c;
+        });
+    }
+
+    void Map::repairClearance(const std::vector<int>& added, const std::vector<int>& removed, DirtyRect& dirty) {
+        if (nearest_.empty()) {
+            // First incremental update, redo the transform once to learn each cell's closest obstacle
+            const size_t cells = static_cast<size_t>(getNumCells());
+            nearest_.assign(cells, -1);
+            std::vector<std::uint64_t> previous(occupancy_, occupancy_ + (cells + 63) / 64);
+            for (int cell : added) {
+                previous[cell >> 6] &= ~(std::uint64_t(1) << (cell & 63));
             }
-            std::cout << std::endl;
-        }
-        else 
-        {
-            std::cout << "Distance Map:" << std::endl;
-            for (int row = 0; row < numRows_; ++row) {
-                std::cout << "\033[0m"; // white
-                std::cout << std::setw(2) << row << "| ";
-                for (int col = 0; col < numCols_; ++col) {
-                    if (grid_[row][col].isObstacle()) {
-                        std::cout << "\033[31m"; // red
-                        
-                    }
-                    else if (grid_[row][col].isStart()) {
-                        std::cout << "\033[34m"; // blue
-                        
-                    }
-                    else if (grid_[row][col].isEnd()) {
-                        std::cout << "\033[32m"; // green
-                        
-                    }
-                    else if (grid_[row][col].isRobot()) {
-                        std::cout << "\033[33m"; // Yellow
-                        
-                    }
-                    else if (grid_[row][col].isBestPath()) {
-                        std::cout << "\033[35m"; // Magenta
-                    }
-                    else if (grid_[row][col].isPath()) {
-                        std::cout << "\033[36m"; // Cyan
-                        
-                    }
-                    else {
-                        std::cout << "\033[0m"; // white
-                    }
-                    if (grid_[row][col].getDistance() == INT_MAX) {
-                        std::cout << std::setw(6) << "INF ";
-                    }
-                    else {
-                        std::cout << std::setw(6) << grid_[row][col].getDistance();
-                    }
+            for (int cell : removed) {
+                previous[cell >> 6] |= std::uint64_t(1) << (cell & 63);
+            }
+            distanceTransform_.compute(previous.data(), numRows_, numCols_, distanceMetric_, clearance_, nearest_.data());
+        }
+        distanceTransform_.update(occupancy_, numRows_, numCols_, distanceMetric_, clearance_, nearest_.data(), added, removed, dirty);
+        ++version_;
+    }
+
+    DirtyRect Map::addObstacle(int x, int y, int radius) {
+        createObstacle(x, y, radius);
+
+        std::vector<int> added;
+        stampObstacle(obstaclesList_.back(), &added);
+
+        DirtyRect dirty;
+        if (!added.empty()) {
+            repairClearance(added, std::vector<int>(), dirty);
+        }
+        return dirty;
+    }
+
+    DirtyRect Map::removeObstacle(int x, int y, int radius) {
+        std::vector<Obstacle>::iterator it = obstaclesList_.begin();
+        for (; it != obstaclesList_.end(); ++it) {
+            if (it->getObstacleCenterNode().getRow() == x && it->getObstacleCenterNode().getCol() == y && it->getObstacleRadius() == radius) {
+                break;
+            }
+        }
+        if (it == obstaclesList_.end()) {
+            throw std::invalid_argument("No obstacle at (" + std::to_string(x) + "," + std::to_string(y) + ") with radius " + std::to_string(radius));
+        }
+        Obstacle removedObstacle = *it;
+        obstaclesList_.erase(it);
+
+        // Free the cells of the obstacle that no other obstacle still covers
+        std::vector<int> cells, removed;
+        obstacleCells(removedObstacle, cells);
+        for (int cell : cells) {
+            if (!isObstacle(cell)) {
+                continue;
+            }
+            const int row = getRow(cell);
+            const int col = getCol(cell);
+            bool covered = false;
+            for (const Obstacle& other : obstaclesList_) {
+                int dx = row - other.getObstacleCenterNode().getRow();
+                int dy = col - other.getObstacleCenterNode().getCol();
+                if (dx * dx + dy * dy <= other.getObstacleRadius() * other.getObstacleRadius()) {
+                    covered = true;
+                    break;
                 }
-                std::cout << std::endl;
             }
-            std::cout << "\033[0m"; // white
-            
-            // Print the column numbers
-            std::cout << std::setw(3) << "-";
-            for (int c = 0; c < numCols_; ++c) {
-                std::cout << std::setw(6) << " ---";
+            if (!covered) {
+                setObstacle(cell, false);
+                removed.push_back(cell);
             }
-            std::cout << std::endl << "  ";
-            for (int c = 0; c < numCols_; ++c) {
-                std::cout << std::setw(6) << c;
+        }
+
+        DirtyRect dirty;
+        if (!removed.empty()) {
+            repairClearance(std::vector<int>(), removed, dirty);
+        }
+        return dirty;
+    }
+
+    double Map::getDistance(int index) const {
+        if (clearance_[index] == INT_MAX) {
+            return std::numeric_limits<double>::infinity();
+        }
+        return std::sqrt(static_cast<double>(clearance_[index]));
+    }
+
+    ConsoleColor Map::getConsoleColor(int index) const {
+        if (isObstacle(index)) {
+            return ConsoleColor::Red;
+        }
+        if (hasFlag(index, CELL_START)) {
+            return ConsoleColor::Blue;
+        }
+        if (hasFlag(index, CELL_END)) {
+            return ConsoleColor::Green;
+        }
+        if (hasFlag(index, CELL_ROBOT)) {
+            return ConsoleColor::Yellow;
+        }
+        if (hasFlag(index, CELL_BEST_PATH)) {
+            return ConsoleColor::Magenta;
+        }
+        if (hasFlag(index, CELL_PATH)) {
+            return ConsoleColor::Cyan;
+        }
+        return ConsoleColor::Default;
+    }
+
+    void Map::drawToConsole(ConsoleFrame& frame, bool showBinary) const {
+
+        // A title line, a line per row, the column rule and the column numbers
+        const int labelWidth = std::max(2, static_cast<int>(std::to_string(std::max(numRows_ - 1, 0)).size()));
+        const int left = labelWidth + 2;
+        frame.begin(numRows_ + 3, left + 6 * numCols_);
+        frame.put(0, 0, showBinary ? "Binary Map:" : "Distance Map:");
+
+        char text[32];
+        for (int row = 0; row < numRows_; ++row) {
+            const int line = row + 1;
+            std::snprintf(text, sizeof(text), "%d", row);
+            frame.putRight(line, 0, labelWidth, text);
+            frame.put(line, labelWidth, "| ");
+            for (int col = 0; col < numCols_; ++col) {
+                const int index = getIndex(row, col);
+                const ConsoleColor color = getConsoleColor(index);
+                if (showBinary) {
+                    // The robot shows as 1 like the obstacles, in its own color
+                    const bool occupied = color == ConsoleColor::Red || color == ConsoleColor::Yellow;
+                    frame.putRight(line, left + 6 * col, 6, occupied ? " 1  " : " 0  ", color);
+                }
+                else if (getDistanceSquared(index) == INT_MAX) {
+                    frame.putRight(line, left + 6 * col, 6, "INF ", color);
+                }
+                else {
+                    std::snprintf(text, sizeof(text), "%.3g", getDistance(index));
+                    frame.putRight(line, left + 6 * col, 6, text, color);
+                }
             }
-            std::cout << std::endl;
+        }
+
+        // Print the column numbers
+        frame.put(numRows_ + 1, labelWidth, showBinary ? "+" : "-");
+        for (int col = 0; col < numCols_; ++col) {
+            frame.put(numRows_ + 1, left - 1 + 6 * col, "   ---");
+            std::snprintf(text, sizeof(text), "%d", col);
+            frame.putRight(numRows_ + 2, left - 2 + 6 * col, 6, text);
         }
     }
 
+    void Map::printToConsole(bool showBinary) const
+    {
+        ConsoleFrame frame;
+        drawToConsole(frame, showBinary);
+        const std::string& text = frame.flatten();
+        std::cout.write(text.data(), static_cast<std::streamsize>(text.size()));
+        std::cout.flush();
+    }
+
     void Map::saveToFile(const std::string& filename) {
         
         // Save the Map object to a file
-        std::ofstream outfile(filename);
-        if (outfile.is_open()) {
-            serializeMap(outfile);
-            outfile.close();
-        }
-        else {
-            std::cout << "Unable to open file: "<< filename << std::endl;
-            throw std::invalid_argument("Unable to open file");
-        }
+        saveBinary(filename);
         
     }
 
     void Map::loadFromFile(std::string& filename) {
         
+        // Binary map files are mapped, anything else is read as the layer stream of serializeMap()
+        char magic[sizeof(MAP_FILE_MAGIC)] = {};
+        std::ifstream probe(filename, std::ios::binary);
+        probe.read(magic, sizeof(magic));
+        const bool binary = probe && std::memcmp(magic, MAP_FILE_MAGIC, sizeof(magic)) == 0;
+        probe.close();
+
         // Load the Map object from the file
         std::ifstream infile(filename);
         if (infile.is_open()) {
             try {
             
-                this->deserializeMap(infile);
-                infile.close();
+                if (binary) {
+                    infile.close();
+                    loadBinary(filename);
+                }
+                else {
+                    this->deserializeMap(infile);
+                    infile.close();
+                }
             }
             catch (const std::exception& e) {
                 std::cout << "Error: " << e.what() << std::endl;
@@ -300,11 +463,12 @@ namespace RPP
             file.write(reinterpret_cast<const char*>(&numRows_), sizeof(numRows_));
             file.write(reinterpret_cast<const char*>(&numCols_), sizeof(numCols_));
 
-            for (const auto& row : grid_) {
-                for (const auto& node : row) {
-                    node.serializeNode(file);
-                }
-            }
+            // Write the cell layers, search state is per query and is not saved
+            const size_t cells = static_cast<size_t>(getNumCells());
+            const std::vector<unsigned char> noFlags(flags_.empty() ? cells : 0, 0);
+            file.write(reinterpret_cast<const char*>(occupancy_), (cells + 63) / 64 * sizeof(std::uint64_t));
+            file.write(reinterpret_cast<const char*>(clearance_), cells * sizeof(int));
+            file.write(reinterpret_cast<const char*>(flags_.empty() ? noFlags.data() : flags_.data()), cells);
 
             size_t num_obstacles = obstaclesList_.size();
 
@@ -328,11 +492,17 @@ namespace RPP
 
             // Create a new Map object with the correct size
             Map new_map(num_rows, num_cols);
-            // Read the grid data into the new Map object
-            for (auto& row : new_map.getGrid()) {
-                for (auto& node : row) {
-                    node.deserializeNode(file);
-                }
+            // Read the cell layers into the new Map object
+            file.read(reinterpret_cast<char*>(new_map.occupancy_), new_map.occupancyStorage_.size() * sizeof(std::uint64_t));
+            file.read(reinterpret_cast<char*>(new_map.clearance_), new_map.clearanceStorage_.size() * sizeof(int));
+            std::vector<unsigned char> flags(new_map.clearanceStorage_.size());
+            file.read(reinterpret_cast<char*>(flags.data()), flags.size());
+            if (!file) {
+                throw std::runtime_error("Failed to read map cells");
+            }
+            // Flags are allocated on first use, a file without any leaves them so
+            if (std::find_if(flags.begin(), flags.end(), [](unsigned char flag) { return flag != 0; }) != flags.end()) {
+                new_map.flags_.swap(flags);
             }
             // Read the obstacle data into the new Map object
             size_t num_obstacles;
@@ -343,6 +513,8 @@ namespace RPP
                 obstacle.deserializeObstacle(file);
             }
             // Assign the new Map object to the current object
+            // The loaded layers replace ours, so move the version past anything cached for the old ones
+            new_map.version_ = version_ + 1;
             using std::swap;
             swap(*this, new_map);
             
@@ -353,57 +525,23 @@ namespace RPP
     void Node::serializeNode(std::ostream& os) const {
         os.write(reinterpret_cast<const char*>(&x_), sizeof(x_));
         os.write(reinterpret_cast<const char*>(&y_), sizeof(y_));
-        os.write(reinterpret_cast<const char*>(&isObstacle_), sizeof(isObstacle_));
-        os.write(reinterpret_cast<const char*>(&distanceToObstacle_), sizeof(distanceToObstacle_));
-        os.write(reinterpret_cast<const char*>(&isStart_), sizeof(isStart_));
-        os.write(reinterpret_cast<const char*>(&isEnd_), sizeof(isEnd_));
-        os.write(reinterpret_cast<const char*>(&isRobot_), sizeof(isRobot_));
-        os.write(reinterpret_cast<const char*>(&isPath_), sizeof(isPath_));
-        os.write(reinterpret_cast<const char*>(&isBestPath_), sizeof(isBestPath_));
-        os.write(reinterpret_cast<const char*>(&heuristic_), sizeof(heuristic_));
-        os.write(reinterpret_cast<const char*>(&gScore_), sizeof(gScore_));
-        os.write(reinterpret_cast<const char*>(&f_), sizeof(f_));
-        const std::int32_t  parent_index = (parent_ == nullptr) ? -1 : 1;
-        os.write(reinterpret_cast<const char*>(&parent_index), sizeof(parent_index));
-
-        if (parent_index != -1) {
-            parent_->serializeNode(os);
-        }
     }
 
     void Node::deserializeNode(std::istream& is) {
         if (is) {
             is.read(reinterpret_cast<char*>(&x_), sizeof(x_));
             is.read(reinterpret_cast<char*>(&y_), sizeof(y_));
-            is.read(reinterpret_cast<char*>(&isObstacle_), sizeof(isObstacle_));
-            is.read(reinterpret_cast<char*>(&distanceToObstacle_), sizeof(distanceToObstacle_));
-            is.read(reinterpret_cast<char*>(&isStart_), sizeof(isStart_));
-            is.read(reinterpret_cast<char*>(&isEnd_), sizeof(isEnd_));
-            is.read(reinterpret_cast<char*>(&isRobot_), sizeof(isRobot_));
-            is.read(reinterpret_cast<char*>(&isPath_), sizeof(isPath_));
-            is.read(reinterpret_cast<char*>(&isBestPath_), sizeof(isBestPath_));
-            is.read(reinterpret_cast<char*>(&heuristic_), sizeof(heuristic_));
-            is.read(reinterpret_cast<char*>(&gScore_), sizeof(gScore_));
-            is.read(reinterpret_cast<char*>(&f_), sizeof(f_));
-            std::int32_t  parent_index;
-            is.read(reinterpret_cast<char*>(&parent_index), sizeof(parent_index));
-
-            if (parent_index != -1) {
-                parent_ = new Node();
-                parent_->deserializeNode(is);
-                
-            }
         }
     }
 
     void Obstacle::serializeObstacle(std::ostream& os) const {
-        os.write(reinterpret_cast<const char*>(&obstacleCenterNode_), sizeof(obstacleCenterNode_));
+        obstacleCenterNode_.serializeNode(os);
         os.write(reinterpret_cast<const char*>(&obstacleRadius_), sizeof(obstacleRadius_));
     }
 
     void Obstacle::deserializeObstacle(std::istream& is) {
         if (is.good()) {
-            is.read(reinterpret_cast<char*>(&obstacleCenterNode_), sizeof(obstacleCenterNode_));
+            obstacleCenterNode_.deserializeNode(is);
         }
         else {
             throw std::runtime_error("Failed to read obstacle center node");
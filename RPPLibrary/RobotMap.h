@@ -3,100 +3,71 @@
 #include <string>
 #include <memory>
 #include <limits>
+#include <climits>
+#include <cstdint>
 #include <vector>
+#include "RobotDistance.h"
+#include "RobotInflation.h"
+#include "RobotMapFile.h"
+#include "RobotConsole.h"
 
 namespace RPP
 {
+    // Visualizer bits packed into one byte per cell.
+    enum CellFlag : unsigned char {
+        CELL_START = 1 << 0,
+        CELL_END = 1 << 1,
+        CELL_ROBOT = 1 << 2,
+        CELL_PATH = 1 << 3,
+        CELL_BEST_PATH = 1 << 4
+    };
+
+    // Row and column offsets of the eight directions, in neighbor order 0 1 2 / 3 . 4 / 5 6 7
+    const int NEIGHBOR_ROW[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+    const int NEIGHBOR_COL[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+    // Euclidean length of a step in each direction
+    const double NEIGHBOR_COST[8] = { 1.4142135623730951, 1.0, 1.4142135623730951, 1.0, 1.0, 1.4142135623730951, 1.0, 1.4142135623730951 };
+
+    // A cell coordinate. Everything known about the cell lives in the Map layers.
     class Node {
-        
-        double max = 999999999;
 
         public:
-            
+
             // Default Contructor
             Node(int x = -1, int y = -1)
                 :
                 x_(x),
-                y_(y),
-                isObstacle_(false),
-                distanceToObstacle_(INT_MAX),
-                isStart_(false),
-                isEnd_(false),
-                isRobot_(false),
-                isPath_(false),
-                isBestPath_(false),
-                heuristic_(max),
-                gScore_(0.0),
-                f_(0.0),
-                parent_(nullptr)
+                y_(y)
             {}
 
-            // Setters
-            void setObstacle(bool isObstacle) { isObstacle_ = isObstacle; }
-            void setDistance(int distance) { distanceToObstacle_ = distance; }
-            void setIsStart() { isStart_ = true; }
-            void setIsEnd() { isEnd_ = true; }
-            void setIsRobot(bool isRobot) { isRobot_ = isRobot; }
-            void setIsPath(bool isPath) { isPath_ = isPath; }
-            void setIsBestPath(bool isBestPath) { isBestPath_ = isBestPath; }
-            void setNeighbors(std::vector<Node*>& neighbors) { neighbors_ = neighbors; }
-            void setHeuristic(double heuristic) { heuristic_ = heuristic; }
-            void setGScore(double gScore) { gScore_ = gScore; }
-            void setF(double f) { f_ = f; }
-            void setParent(Node* parent) { parent_ = parent; }
-
             // Getters
             int getRow() const { return x_; }
             int getCol() const { return y_; }
-            bool isObstacle() const { return isObstacle_; }
-            int getDistance() const { return distanceToObstacle_; }
-            bool isStart() const { return isStart_; }
-            bool isEnd() const { return isEnd_; }
-            bool isRobot() const { return isRobot_; }
-            bool isPath() const { return isPath_; }
-            bool isBestPath() const { return isBestPath_; }
-            std::vector<Node*>& getNeighbors() { return neighbors_; }
-            double getHeuristic() const { return heuristic_; }
-            double getGScore() const { return gScore_; }
-            double getF() const { return f_; }
-            Node* getParent() const { return parent_; }
 
             void serializeNode(std::ostream& os) const;
             void deserializeNode(std::istream& is);
 
         private:
-        
+
             int x_;
             int y_;
-            bool isObstacle_;
-            int distanceToObstacle_;
-            bool isStart_;
-            bool isEnd_;
-            bool isRobot_;
-            bool isPath_;
-            bool isBestPath_;
-            std::vector<Node*> neighbors_;
-            double heuristic_;
-            double gScore_;
-            double f_;
-            Node* parent_;
 
     };
 
     class Obstacle {
-    
+
         public:
-        
+
             Obstacle()
                 :
                 obstacleCenterNode_(),
                 obstacleRadius_(0)
             {}
 
-            Obstacle(Node obstacleCenterNode, int radius) 
-                : 
-                obstacleCenterNode_(obstacleCenterNode), 
-                obstacleRadius_(radius) 
+            Obstacle(Node obstacleCenterNode, int radius)
+                :
+                obstacleCenterNode_(obstacleCenterNode),
+                obstacleRadius_(radius)
             {}
 
             // Setters
@@ -114,55 +85,229 @@ namespace RPP
             void deserializeObstacle(std::istream& is);
 
         private:
-        
+
             Node obstacleCenterNode_;
             int obstacleRadius_;
     };
 
+    // The up to eight cells around a cell. Neighbors are not stored, they are found
+    // from fixed index offsets into the row-major grid and a mask of the sides that
+    // fall off the map.
+    class NeighborRange {
+
+        public:
+
+            class iterator {
+
+                public:
+
+                    iterator(int origin, const int* offsets, unsigned mask)
+                        :
+                        origin_(origin),
+                        offsets_(offsets),
+                        mask_(mask),
+                        direction_(0)
+                    {
+                        skip();
+                    }
+
+                    int operator*() const { return origin_ + offsets_[direction_]; }
+                    iterator& operator++() { ++direction_; skip(); return *this; }
+                    bool operator!=(const iterator& other) const { return direction_ != other.direction_; }
+                    bool operator==(const iterator& other) const { return direction_ == other.direction_; }
+
+                    // Index 0-7 of the current direction in NEIGHBOR_ROW / NEIGHBOR_COL
+                    int getDirection() const { return direction_; }
+
+                private:
+
+                    int origin_;
+                    const int* offsets_;
+                    unsigned mask_;
+                    int direction_;
+
+                    void skip() {
+                        while (direction_ < 8 && !(mask_ & (1u << direction_))) {
+                            ++direction_;
+                        }
+                    }
+            };
+
+            NeighborRange(int origin, const int* offsets, unsigned mask)
+                :
+                origin_(origin),
+                offsets_(offsets),
+                mask_(mask)
+            {}
+
+            iterator begin() const { return iterator(origin_, offsets_, mask_); }
+            iterator end() const { return iterator(origin_, offsets_, 0); }
+
+        private:
+
+            int origin_;
+            const int* offsets_;
+            unsigned mask_;
+    };
+
+    // The grid is kept as separate row-major layers so each pass only pulls in the
+    // bytes it needs: an occupancy bitmap, a clearance array and one byte of visualizer
+    // flags per cell. Per-query search state lives in a SearchContext, so searches only
+    // read the Map and any number of them can share one.
+    // A map loaded with loadBinary() plans straight off the memory mapped file. Its layers
+    // are copy-on-write pages of the file, edits stay in memory and copies of the map get
+    // layers of their own.
     class Map {
-    
+
         public:
-            
+
             // Default constructor
-            Map() 
-                : 
+            Map()
+                :
                 numRows_(0),
                 numCols_(0),
-                grid_(),
-                obstaclesList_()
+                occupancy_(nullptr),
+                clearance_(nullptr),
+                occupancyStorage_(),
+                clearanceStorage_(),
+                mappedFile_(),
+                nearest_(),
+                flags_(),
+                obstaclesList_(),
+                neighborOffsets_(),
+                distanceMetric_(DistanceMetric::Euclidean),
+                distanceTransform_(),
+                version_(0),
+                inflation_()
             {}
-            
+
             // Constructor with arguments
             Map(int numRows, int numCols);
-            
-            // Sets neighbors for each node
-            void setNeighbors();
+
+            Map(const Map& other);
+            Map(Map&&) = default;
+            Map& operator=(const Map& other);
+            Map& operator=(Map&&) = default;
+
             void setNumRows(int numRows)  { numRows_ = numRows; }
             void setNumCols(int numCols)  { numCols_ = numCols; }
+            // Takes effect the next time obstacles are added
+            void setDistanceMetric(DistanceMetric metric) { distanceMetric_ = metric; }
+
+            // Cell layer setters
+            void setObstacle(int index, bool isObstacle) {
+                std::uint64_t bit = std::uint64_t(1) << (index & 63);
+                if (isObstacle) { occupancy_[index >> 6] |= bit; } else { occupancy_[index >> 6] &= ~bit; }
+                ++version_;
+            }
+            void setDistanceSquared(int index, int distanceSquared) { clearance_[index] = distanceSquared; ++version_; }
+            void setFlag(int index, CellFlag flag, bool value) {
+                if (flags_.empty()) { flags_.assign(static_cast<size_t>(getNumCells()), 0); }
+                if (value) { flags_[index] |= flag; } else { flags_[index] &= static_cast<unsigned char>(~flag); }
+            }
 
             // Getters
             int getNumRows() const { return numRows_; }
             int getNumCols() const { return numCols_; }
-            std::vector<std::vector<Node>>& getGrid() { return grid_; }
+            int getNumCells() const { return numRows_ * numCols_; }
+            int getIndex(int row, int col) const { return row * numCols_ + col; }
+            int getIndex(const Node& node) const { return getIndex(node.getRow(), node.getCol()); }
+            int getRow(int index) const { return index / numCols_; }
+            int getCol(int index) const { return index % numCols_; }
+            Node getNode(int index) const { return Node(getRow(index), getCol(index)); }
+            bool isInside(int row, int col) const { return row >= 0 && col >= 0 && row < numRows_ && col < numCols_; }
             std::vector<Obstacle> getObstaclesList() const { return obstaclesList_; }
+            DistanceMetric getDistanceMetric() const { return distanceMetric_; }
+            // Moves on whenever occupancy or clearance changes, caches keyed on it go stale
+            unsigned getVersion() const { return version_; }
+            // The layers live in a memory mapped map file
+            bool isMapped() const { return mappedFile_ != nullptr; }
+
+            // Cell layer getters
+            bool isObstacle(int index) const { return (occupancy_[index >> 6] >> (index & 63)) & 1; }
+            // Squared clearance, compare against squared radii to stay in integers. INT_MAX when there are no obstacles.
+            int getDistanceSquared(int index) const { return clearance_[index]; }
+            double getDistance(int index) const;
+            // A robot of this radius centered on the cell clears every obstacle and stays on the map.
+            bool robotFits(int index, int robotRadius) const {
+                const int row = getRow(index);
+                const int col = index - row * numCols_;
+                return clearance_[index] > robotRadius * robotRadius &&
+                    row - robotRadius >= 0 && col - robotRadius >= 0 &&
+                    row + robotRadius < numRows_ && col + robotRadius < numCols_;
+            }
+            // Bit per cell, set where robotFits() holds for the radius. Test it with isTraversable().
+            // Built once per radius and map version, valid until the map changes.
+            const std::uint64_t* getTraversable(int robotRadius) const {
+                return inflation_.get(clearance_, numRows_, numCols_, robotRadius, version_);
+            }
+            bool hasFlag(int index, CellFlag flag) const { return !flags_.empty() && (flags_[index] & flag) != 0; }
+            NeighborRange getNeighbors(int index) const;
 
             // Member Functions
             void createObstacle(int x, int y, int radius);
+            // Stamps the obstacles into the occupancy bits and recomputes the whole clearance
             void addObstaclesToMap(const std::vector<Obstacle>& obstaclesList);
-            void printToConsole(bool showBinary) const;     
-            
+            // Incremental updates, only the clearance around the change is repaired, to the same
+            // values addObstaclesToMap() would compute (see DistanceTransform::update() for the cost).
+            // Both return the cells whose occupancy or clearance changed.
+            DirtyRect addObstacle(int x, int y, int radius);
+            DirtyRect removeObstacle(int x, int y, int radius);
+            // Adds a batch of obstacles with a single clearance update at the end. Throws like
+            // createObstacle() before changing anything if one of them is invalid.
+            DirtyRect addObstacles(const std::vector<Obstacle>& obstacles);
+            // Prints the map with one write, the binary view shows obstacles, the other the clearance
+            void printToConsole(bool showBinary) const;
+            // Draws the same view into a frame, for callers that redraw the map in place
+            void drawToConsole(ConsoleFrame& frame, bool showBinary) const;
+            // Color of the cell in the console views, from its obstacle bit and visualizer flags
+            ConsoleColor getConsoleColor(int index) const;
+
             void serializeMap(std::ofstream& file) const;
             void deserializeMap(std::ifstream& file);
 
+            // Writes the binary map file format, see RobotMapFile.h
             void saveToFile(const std::string& filename);
+            // Reads binary map files, and anything else as the stream of serializeMap(): size,
+            // occupancy bits, clearance, flag bytes and obstacles. Files of the earlier per-Node
+            // stream layout are not supported.
             void loadFromFile(std::string& filename);
 
-        private:                                                                   
-            int numRows_;                                                                               
-            int numCols_;                                                                               
-            std::vector<std::vector<Node>> grid_;                                                       
-            std::vector<Obstacle> obstaclesList_;                                                       
-        
+            // Binary map files. Loading maps the file instead of reading it, there is no per-cell
+            // work beyond the optional checksum pass. Both throw on I/O errors and bad files.
+            void saveBinary(const std::string& filename) const;
+            void loadBinary(const std::string& filename, bool verifyChecksum = true);
+
+            // MovingAI .map grid, see RobotMovingAI.h. Ground, 'G' and swamp are free, everything
+            // else is an obstacle. Throws like the other loaders.
+            void loadMovingAI(const std::string& filename);
+
+        private:
+            int numRows_;
+            int numCols_;
+            std::uint64_t* occupancy_;              // One bit per cell, set for obstacles
+            int* clearance_;                        // Squared distance to the closest obstacle
+            std::vector<std::uint64_t> occupancyStorage_;   // Own layers, empty while the layers are mapped
+            std::vector<int> clearanceStorage_;
+            std::shared_ptr<MappedFile> mappedFile_;        // File the layers were loaded from
+            std::vector<int> nearest_;              // Closest obstacle cell, only kept once incremental updates are used
+            std::vector<unsigned char> flags_;      // CellFlag bits for the visualizer, allocated on first use
+            std::vector<Obstacle> obstaclesList_;
+            int neighborOffsets_[8];                // Index offsets of the eight directions, row by row
+            DistanceMetric distanceMetric_;
+            DistanceTransform distanceTransform_;
+            unsigned version_;
+            mutable InflationCache inflation_;      // Traversability layers per robot radius
+
+            void allocateLayers();
+            void setNeighborOffsets();
+            void computeClearance();
+            bool touchesMap(const Obstacle& obstacle) const;
+            // Sets the obstacle's cells a row span at a time, appending the ones that were free to added
+            void stampObstacle(const Obstacle& obstacle, std::vector<int>* added);
+            void obstacleCells(const Obstacle& obstacle, std::vector<int>& cells) const;
+            void repairClearance(const std::vector<int>& added, const std::vector<int>& removed, DirtyRect& dirty);
+
 
     };
 
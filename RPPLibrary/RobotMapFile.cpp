@@ -0,0 +1,353 @@
+#include "RobotMapFile.h"
+#include "RobotMap.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace RPP
+{
+    namespace
+    {
+        const std::uint64_t PRIME = 0x9E3779B97F4A7C15ull;
+
+        std::uint64_t rotate(std::uint64_t value, int bits) {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        std::uint64_t loadWord(const unsigned char* data) {
+            std::uint64_t word;
+            std::memcpy(&word, data, sizeof(word));
+            return word;
+        }
+
+        std::size_t alignSection(std::size_t offset) {
+            return (offset + MAP_FILE_ALIGNMENT - 1) / MAP_FILE_ALIGNMENT * MAP_FILE_ALIGNMENT;
+        }
+
+        // Where the sections of a map of this size go
+        struct MapFileLayout {
+            std::size_t occupancyBytes;
+            std::size_t clearanceBytes;
+            std::size_t obstacleBytes;
+            std::size_t occupancyOffset;
+            std::size_t clearanceOffset;
+            std::size_t obstacleOffset;
+            std::size_t fileSize;
+
+            MapFileLayout(std::size_t cells, std::size_t obstacles)
+                :
+                occupancyBytes((cells + 63) / 64 * sizeof(std::uint64_t)),
+                clearanceBytes(cells * sizeof(std::int32_t)),
+                obstacleBytes(obstacles * 3 * sizeof(std::int32_t)),
+                occupancyOffset(sizeof(MapFileHeader)),
+                clearanceOffset(alignSection(occupancyOffset + occupancyBytes)),
+                obstacleOffset(alignSection(clearanceOffset + clearanceBytes)),
+                fileSize(alignSection(obstacleOffset + obstacleBytes))
+            {}
+        };
+    }
+
+    MapFileChecksum::MapFileChecksum()
+        :
+        pendingSize_(0),
+        totalSize_(0)
+    {
+        lanes_[0] = 0x243F6A8885A308D3ull;
+        lanes_[1] = 0x13198A2E03707344ull;
+        lanes_[2] = 0xA4093822299F31D0ull;
+        lanes_[3] = 0x082EFA98EC4E6C89ull;
+    }
+
+    void MapFileChecksum::block(const unsigned char* data) {
+        for (int lane = 0; lane < 4; ++lane) {
+            lanes_[lane] = rotate(lanes_[lane] ^ loadWord(data + lane * 8), 29) * PRIME;
+        }
+    }
+
+    void MapFileChecksum::update(const void* data, std::size_t size) {
+        if (size == 0) {
+            return;
+        }
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        totalSize_ += size;
+
+        // Top up a block left over from the last call first
+        if (pendingSize_ > 0) {
+            const std::size_t take = size < sizeof(pending_) - pendingSize_ ? size : sizeof(pending_) - pendingSize_;
+            std::memcpy(pending_ + pendingSize_, bytes, take);
+            pendingSize_ += take;
+            bytes += take;
+            size -= take;
+            if (pendingSize_ < sizeof(pending_)) {
+                return;
+            }
+            block(pending_);
+            pendingSize_ = 0;
+        }
+
+        for (; size >= sizeof(pending_); bytes += sizeof(pending_), size -= sizeof(pending_)) {
+            block(bytes);
+        }
+        std::memcpy(pending_, bytes, size);
+        pendingSize_ = size;
+    }
+
+    std::uint64_t MapFileChecksum::finish() const {
+        std::uint64_t lanes[4] = { lanes_[0], lanes_[1], lanes_[2], lanes_[3] };
+        if (pendingSize_ > 0) {
+            unsigned char last[sizeof(pending_)] = {};
+            std::memcpy(last, pending_, pendingSize_);
+            for (int lane = 0; lane < 4; ++lane) {
+                lanes[lane] = rotate(lanes[lane] ^ loadWord(last + lane * 8), 29) * PRIME;
+            }
+        }
+
+        // Fold the lanes and the length together, then mix so every input bit reaches every output bit
+        std::uint64_t hash = totalSize_ * PRIME;
+        for (int lane = 0; lane < 4; ++lane) {
+            hash = rotate(hash ^ lanes[lane], 27) * PRIME + lane;
+        }
+        hash ^= hash >> 33;
+        hash *= 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 33;
+        hash *= 0xC4CEB9FE1A85EC53ull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+#ifdef _WIN32
+
+    MappedFile::MappedFile(const std::string& filename)
+        :
+        data_(nullptr),
+        size_(0)
+    {
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Unable to open file: " + filename);
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            CloseHandle(file);
+            throw std::runtime_error("Unable to map empty file: " + filename);
+        }
+
+        // The view keeps the mapping and the file alive, both handles can go right away
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr) {
+            throw std::runtime_error("Unable to map file: " + filename);
+        }
+        void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+        CloseHandle(mapping);
+        if (view == nullptr) {
+            throw std::runtime_error("Unable to map file: " + filename);
+        }
+        data_ = static_cast<unsigned char*>(view);
+        size_ = static_cast<std::size_t>(size.QuadPart);
+    }
+
+    MappedFile::~MappedFile() {
+        UnmapViewOfFile(data_);
+    }
+
+#else
+
+    MappedFile::MappedFile(const std::string& filename)
+        :
+        data_(nullptr),
+        size_(0)
+    {
+        const int file = open(filename.c_str(), O_RDONLY);
+        if (file < 0) {
+            throw std::runtime_error("Unable to open file: " + filename);
+        }
+        struct stat status;
+        if (fstat(file, &status) != 0 || status.st_size == 0) {
+            close(file);
+            throw std::runtime_error("Unable to map empty file: " + filename);
+        }
+
+        // Private mapping, the descriptor is not needed once the pages are mapped
+        void* view = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+        close(file);
+        if (view == MAP_FAILED) {
+            throw std::runtime_error("Unable to map file: " + filename);
+        }
+        data_ = static_cast<unsigned char*>(view);
+        size_ = static_cast<std::size_t>(status.st_size);
+    }
+
+    MappedFile::~MappedFile() {
+        munmap(data_, size_);
+    }
+
+#endif
+
+    void Map::saveBinary(const std::string& filename) const {
+        if (!isLittleEndianHost()) {
+            throw std::runtime_error("Binary map files need a little-endian host");
+        }
+
+        const std::size_t cells = static_cast<std::size_t>(getNumCells());
+        const MapFileLayout layout(cells, obstaclesList_.size());
+
+        std::vector<std::int32_t> obstacles;
+        obstacles.reserve(obstaclesList_.size() * 3);
+        for (const Obstacle& obstacle : obstaclesList_) {
+            obstacles.push_back(obstacle.getObstacleCenterNode().getRow());
+            obstacles.push_back(obstacle.getObstacleCenterNode().getCol());
+            obstacles.push_back(obstacle.getObstacleRadius());
+        }
+
+        MapFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, MAP_FILE_MAGIC, sizeof(header.magic));
+        header.version = MAP_FILE_VERSION;
+        header.headerSize = sizeof(MapFileHeader);
+        header.numRows = numRows_;
+        header.numCols = numCols_;
+        header.distanceMetric = static_cast<std::uint32_t>(distanceMetric_);
+        header.obstacleCount = static_cast<std::uint32_t>(obstaclesList_.size());
+        header.occupancyOffset = layout.occupancyOffset;
+        header.clearanceOffset = layout.clearanceOffset;
+        header.obstacleOffset = layout.obstacleOffset;
+        header.fileSize = layout.fileSize;
+
+        // Sections in file order, each followed by the zeros up to where the next one starts
+        struct Section {
+            const void* data;
+            std::size_t size;
+            std::size_t end;
+        };
+        const Section sections[3] = {
+            { occupancy_, layout.occupancyBytes, layout.clearanceOffset },
+            { clearance_, layout.clearanceBytes, layout.obstacleOffset },
+            { obstacles.data(), layout.obstacleBytes, layout.fileSize }
+        };
+        const unsigned char padding[MAP_FILE_ALIGNMENT] = {};
+
+        MapFileChecksum checksum;
+        checksum.update(&header, sizeof(header));
+        std::size_t offset = sizeof(header);
+        for (const Section& section : sections) {
+            checksum.update(section.data, section.size);
+            checksum.update(padding, section.end - offset - section.size);
+            offset = section.end;
+        }
+        header.checksum = checksum.finish();
+
+        // Write next to the target and rename over it, so a process still mapping the old file keeps its pages
+        const std::string temporary = filename + ".tmp";
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::invalid_argument("Unable to open file: " + temporary);
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        offset = sizeof(header);
+        for (const Section& section : sections) {
+            file.write(static_cast<const char*>(section.data), static_cast<std::streamsize>(section.size));
+            file.write(reinterpret_cast<const char*>(padding), static_cast<std::streamsize>(section.end - offset - section.size));
+            offset = section.end;
+        }
+        file.close();
+        if (!file) {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Failed to write map file: " + temporary);
+        }
+
+        // Renaming over an existing file fails on Windows, remove it first there
+        if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+            std::remove(filename.c_str());
+            if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+                std::remove(temporary.c_str());
+                throw std::runtime_error("Unable to replace file: " + filename);
+            }
+        }
+    }
+
+    void Map::loadBinary(const std::string& filename, bool verifyChecksum) {
+        if (!isLittleEndianHost()) {
+            throw std::runtime_error("Binary map files need a little-endian host");
+        }
+
+        std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(filename);
+        const unsigned char* data = file->data();
+        if (file->size() < sizeof(MapFileHeader)) {
+            throw std::runtime_error("Map file is truncated: " + filename);
+        }
+        MapFileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+
+        if (std::memcmp(header.magic, MAP_FILE_MAGIC, sizeof(header.magic)) != 0) {
+            throw std::runtime_error("Not a map file: " + filename);
+        }
+        if (header.version != MAP_FILE_VERSION || header.headerSize != sizeof(MapFileHeader)) {
+            throw std::runtime_error("Unsupported map file version " + std::to_string(header.version) + ": " + filename);
+        }
+        if (header.numRows <= 0 || header.numCols <= 0 || static_cast<std::int64_t>(header.numRows) * header.numCols > INT_MAX ||
+            (header.distanceMetric != static_cast<std::uint32_t>(DistanceMetric::Chessboard) &&
+             header.distanceMetric != static_cast<std::uint32_t>(DistanceMetric::Euclidean))) {
+            throw std::runtime_error("Map file header is corrupt: " + filename);
+        }
+
+        // The sections must sit exactly where a writer would have put them
+        const MapFileLayout layout(static_cast<std::size_t>(header.numRows) * header.numCols, header.obstacleCount);
+        if (header.fileSize != file->size() || header.fileSize != layout.fileSize ||
+            header.occupancyOffset != layout.occupancyOffset || header.clearanceOffset != layout.clearanceOffset ||
+            header.obstacleOffset != layout.obstacleOffset) {
+            throw std::runtime_error("Map file is truncated or corrupt: " + filename);
+        }
+
+        if (verifyChecksum) {
+            MapFileHeader zeroed = header;
+            zeroed.checksum = 0;
+            MapFileChecksum checksum;
+            checksum.update(&zeroed, sizeof(zeroed));
+            checksum.update(data + sizeof(zeroed), file->size() - sizeof(zeroed));
+            if (checksum.finish() != header.checksum) {
+                throw std::runtime_error("Map file checksum mismatch: " + filename);
+            }
+        }
+
+        // The layers stay in the file, only the obstacle table is read out
+        Map loaded;
+        loaded.numRows_ = header.numRows;
+        loaded.numCols_ = header.numCols;
+        loaded.distanceMetric_ = static_cast<DistanceMetric>(header.distanceMetric);
+        loaded.occupancy_ = reinterpret_cast<std::uint64_t*>(file->data() + layout.occupancyOffset);
+        loaded.clearance_ = reinterpret_cast<int*>(file->data() + layout.clearanceOffset);
+        loaded.mappedFile_ = file;
+        loaded.setNeighborOffsets();
+
+        const unsigned char* obstacle = data + layout.obstacleOffset;
+        loaded.obstaclesList_.reserve(header.obstacleCount);
+        for (std::uint32_t i = 0; i < header.obstacleCount; ++i, obstacle += 3 * sizeof(std::int32_t)) {
+            std::int32_t fields[3];
+            std::memcpy(fields, obstacle, sizeof(fields));
+            loaded.obstaclesList_.push_back(Obstacle(Node(fields[0], fields[1]), fields[2]));
+        }
+
+        // The loaded layers replace ours, so move the version past anything cached for the old ones
+        loaded.version_ = version_ + 1;
+        using std::swap;
+        swap(*this, loaded);
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace RPP
+{
+    // Binary map file, little-endian throughout:
+    //
+    //   header        MapFileHeader, 128 bytes
+    //   occupancy     one bit per cell in 64-bit words, row-major, set for obstacles
+    //   clearance     one 32-bit squared clearance per cell, row-major, INT_MAX without obstacles
+    //   obstacles     row, column and radius of each obstacle as 32-bit integers
+    //
+    // Sections start on 64-byte boundaries and are zero padded to the next one, so the layers
+    // can be used in place from a memory mapped file. The checksum covers the whole file with
+    // the checksum field taken as zero. Readers reject any format version they do not know.
+    const std::uint32_t MAP_FILE_VERSION = 1;
+    const std::size_t MAP_FILE_ALIGNMENT = 64;
+
+    struct MapFileHeader {
+        char magic[8];                  // MAP_FILE_MAGIC
+        std::uint32_t version;          // MAP_FILE_VERSION
+        std::uint32_t headerSize;       // sizeof(MapFileHeader)
+        std::int32_t numRows;
+        std::int32_t numCols;
+        std::uint32_t distanceMetric;   // DistanceMetric the clearance was computed with
+        std::uint32_t obstacleCount;
+        std::uint64_t occupancyOffset;  // Byte offsets of the sections from the start of the file
+        std::uint64_t clearanceOffset;
+        std::uint64_t obstacleOffset;
+        std::uint64_t fileSize;
+        std::uint64_t checksum;
+        std::uint8_t reserved[56];      // Zero
+    };
+
+    static_assert(sizeof(MapFileHeader) == 128, "Map file header must stay 128 bytes");
+
+    // First bytes of every map file. The line break and the 0x1A catch files that went through a
+    // text mode transfer, the high first byte files that lost their eighth bit.
+    const char MAP_FILE_MAGIC[8] = { '\x89', 'R', 'P', 'P', '\r', '\n', '\x1A', '\n' };
+
+    // Map files hold their layers as they sit in memory on a little-endian host
+    inline bool isLittleEndianHost() {
+        const std::uint16_t probe = 1;
+        unsigned char first;
+        std::memcpy(&first, &probe, 1);
+        return first == 1;
+    }
+
+    // 64-bit checksum of map files, fed in pieces of any size. Four independent lanes
+    // over 64-bit words keep it at about memory speed.
+    class MapFileChecksum {
+
+        public:
+
+            MapFileChecksum();
+
+            void update(const void* data, std::size_t size);
+            std::uint64_t finish() const;
+
+        private:
+
+            std::uint64_t lanes_[4];
+            unsigned char pending_[32];     // Bytes of a block that is not complete yet
+            std::size_t pendingSize_;
+            std::uint64_t totalSize_;
+
+            void block(const unsigned char* data);
+    };
+
+    // A whole file mapped into memory. Pages are copy-on-write: writes
+    // through data() stay private to the process and never reach the file.
+    class MappedFile {
+
+        public:
+
+            // Maps the file, throws std::runtime_error if it can not be opened or mapped
+            explicit MappedFile(const std::string& filename);
+            ~MappedFile();
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            // Getters
+            unsigned char* data() const { return data_; }
+            std::size_t size() const { return size_; }
+
+        private:
+
+            unsigned char* data_;
+            std::size_t size_;
+    };
+}
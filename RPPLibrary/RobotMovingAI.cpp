@@ -0,0 +1,203 @@
+#include "RobotMovingAI.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+
+namespace RPP
+{
+    namespace
+    {
+        // Passable terrain; swamp counts as ground and water, entered only from water, as a wall
+        bool isPassable(char terrain) {
+            return terrain == '.' || terrain == 'G' || terrain == 'S';
+        }
+
+        // Whether a diagonal step of the path goes past a cell the robot does not fit on
+        bool cutsCorner(const Map& map, const std::vector<Node>& path, int robotRadius) {
+            for (size_t i = 1; i < path.size(); ++i) {
+                const int row = path[i - 1].getRow();
+                const int col = path[i - 1].getCol();
+                const int nextRow = path[i].getRow();
+                const int nextCol = path[i].getCol();
+                if (row != nextRow && col != nextCol &&
+                    (!map.robotFits(map.getIndex(nextRow, col), robotRadius) || !map.robotFits(map.getIndex(row, nextCol), robotRadius))) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    void Map::loadMovingAI(const std::string& filename) {
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            throw std::invalid_argument("Unable to open file: " + filename);
+        }
+
+        // Header lines "type octile", "height H" and "width W" in any order, then "map"
+        std::string key;
+        std::string type;
+        int height = -1;
+        int width = -1;
+        while (file >> key && key != "map") {
+            if (key == "type") {
+                file >> type;
+            }
+            else if (key == "height") {
+                file >> height;
+            }
+            else if (key == "width") {
+                file >> width;
+            }
+            else {
+                throw std::runtime_error("Unknown MovingAI map header line '" + key + "': " + filename);
+            }
+        }
+        if (!file || key != "map" || height <= 0 || width <= 0) {
+            throw std::runtime_error("MovingAI map header is incomplete: " + filename);
+        }
+        if (type != "octile") {
+            throw std::runtime_error("Unsupported MovingAI map type '" + type + "': " + filename);
+        }
+
+        // Occupancy is assembled a word at a time straight from the text, the clearance once at the end
+        Map loaded(height, width);
+        loaded.distanceMetric_ = distanceMetric_;
+        std::string line;
+        std::getline(file, line);
+        std::uint64_t word = 0;
+        int index = 0;
+        for (int row = 0; row < height; ++row) {
+            if (!std::getline(file, line) || static_cast<int>(line.size()) < width) {
+                throw std::runtime_error("MovingAI map is missing cells in row " + std::to_string(row) + ": " + filename);
+            }
+            for (int col = 0; col < width; ++col, ++index) {
+                if (!isPassable(line[col])) {
+                    word |= std::uint64_t(1) << (index & 63);
+                }
+                if ((index & 63) == 63) {
+                    loaded.occupancy_[index >> 6] = word;
+                    word = 0;
+                }
+            }
+        }
+        if ((index & 63) != 0) {
+            loaded.occupancy_[index >> 6] = word;
+        }
+        loaded.computeClearance();
+
+        // The loaded layers replace ours, so move the version past anything cached for the old ones
+        loaded.version_ = version_ + 1;
+        using std::swap;
+        swap(*this, loaded);
+    }
+
+    std::vector<MovingAIScenario> loadMovingAIScenarios(const std::string& filename) {
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            throw std::invalid_argument("Unable to open file: " + filename);
+        }
+
+        std::string line;
+        if (!std::getline(file, line) || line.compare(0, 9, "version 1") != 0) {
+            throw std::runtime_error("Not a version 1 MovingAI scenario file: " + filename);
+        }
+
+        // bucket, map, map width, map height, start x, start y, goal x, goal y, optimal length
+        std::vector<MovingAIScenario> scenarios;
+        int lineNumber = 1;
+        while (std::getline(file, line)) {
+            ++lineNumber;
+            if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+            std::istringstream fields(line);
+            MovingAIScenario scenario;
+            int startX, startY, goalX, goalY;
+            if (!(fields >> scenario.bucket >> scenario.mapName >> scenario.mapWidth >> scenario.mapHeight
+                >> startX >> startY >> goalX >> goalY >> scenario.optimalLength)) {
+                throw std::runtime_error("Bad scenario on line " + std::to_string(lineNumber) + ": " + filename);
+            }
+            scenario.start = Node(startY, startX);
+            scenario.goal = Node(goalY, goalX);
+            scenarios.push_back(scenario);
+        }
+        return scenarios;
+    }
+
+    std::vector<ScenarioBucket> runMovingAIScenarios(const Map& map, const std::vector<MovingAIScenario>& scenarios,
+        const PlanParams& params, std::vector<ScenarioOutcome>* outcomes) {
+
+        Planner planner(map);
+        std::map<int, ScenarioBucket> buckets;
+        if (outcomes) {
+            outcomes->clear();
+            outcomes->reserve(scenarios.size());
+        }
+
+        for (const MovingAIScenario& scenario : scenarios) {
+            std::map<int, ScenarioBucket>::iterator found = buckets.find(scenario.bucket);
+            if (found == buckets.end()) {
+                ScenarioBucket empty = ScenarioBucket();
+                empty.bucket = scenario.bucket;
+                found = buckets.insert(std::make_pair(scenario.bucket, empty)).first;
+            }
+            ScenarioBucket& bucket = found->second;
+            ++bucket.scenarios;
+
+            ScenarioOutcome outcome = { ScenarioVerdict::Mismatch, 0.0, 0, 0.0 };
+            if (scenario.mapWidth == map.getNumCols() && scenario.mapHeight == map.getNumRows()) {
+                const PlanResult result = planner.plan(scenario.start, scenario.goal, params);
+                outcome.cost = result.cost;
+                outcome.expansions = result.expansions;
+                outcome.searchMilliseconds = result.searchMilliseconds;
+                bucket.expansions += result.expansions;
+                bucket.heuristicMilliseconds += result.heuristicMilliseconds;
+                bucket.searchMilliseconds += result.searchMilliseconds;
+
+                // Published lengths carry eight decimals
+                const double tolerance = std::max(1e-4, scenario.optimalLength * 1e-8);
+                if (!result.found()) {
+                    outcome.verdict = ScenarioVerdict::NoPath;
+                }
+                else if (std::fabs(result.cost - scenario.optimalLength) <= tolerance) {
+                    outcome.verdict = ScenarioVerdict::Optimal;
+                }
+                else if (result.cost < scenario.optimalLength) {
+                    outcome.verdict = cutsCorner(map, result.path, params.robotRadius) ? ScenarioVerdict::CutsCorner : ScenarioVerdict::Mismatch;
+                }
+                else {
+                    const bool bounded = result.suboptimality > 0.0 && result.cost <= result.suboptimality * scenario.optimalLength + tolerance;
+                    outcome.verdict = bounded ? ScenarioVerdict::WithinBound : ScenarioVerdict::Suboptimal;
+                }
+                if (result.found() && scenario.optimalLength > 0.0) {
+                    bucket.worstRatio = std::max(bucket.worstRatio, result.cost / scenario.optimalLength);
+                }
+            }
+
+            switch (outcome.verdict) {
+            case ScenarioVerdict::Optimal: ++bucket.optimal; break;
+            case ScenarioVerdict::CutsCorner: ++bucket.cutsCorner; break;
+            case ScenarioVerdict::WithinBound: ++bucket.withinBound; break;
+            case ScenarioVerdict::Suboptimal: ++bucket.suboptimal; break;
+            case ScenarioVerdict::Mismatch: ++bucket.mismatch; break;
+            case ScenarioVerdict::NoPath: ++bucket.noPath; break;
+            }
+            if (outcomes) {
+                outcomes->push_back(outcome);
+            }
+        }
+
+        std::vector<ScenarioBucket> result;
+        result.reserve(buckets.size());
+        for (const std::pair<const int, ScenarioBucket>& entry : buckets) {
+            result.push_back(entry.second);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "RobotMap.h"
+#include "RobotPlanner.h"
+
+namespace RPP
+{
+    // MovingAI grid benchmarks, https://movingai.com/benchmarks/grids.html
+    //
+    // A .map file is read into a Map with Map::loadMovingAI(). A .scen file lists start and goal
+    // pairs on such a map along with the optimal path length, found with octile steps that never
+    // cut past a blocked corner. The planner does let a diagonal step squeeze past a corner, so
+    // its paths can come out shorter than published. The runner tells those apart from real errors.
+
+    // One scenario line. The file gives coordinates as x = column, y = row.
+    struct MovingAIScenario {
+        int bucket;                 // Group of scenarios of about the same length
+        std::string mapName;        // Map file as written in the scenario file
+        int mapWidth;
+        int mapHeight;
+        Node start;
+        Node goal;
+        double optimalLength;
+    };
+
+    // Reads a version 1 .scen file. Throws std::invalid_argument if it can not be opened and
+    // std::runtime_error on lines it can not parse.
+    std::vector<MovingAIScenario> loadMovingAIScenarios(const std::string& filename);
+
+    enum class ScenarioVerdict {
+        Optimal,        // Same length as published, up to rounding
+        CutsCorner,     // Shorter, the path squeezes diagonally past a blocked corner
+        WithinBound,    // Longer, but within the suboptimality bound the engine reported
+        Suboptimal,     // Longer than the engine's bound allows
+        Mismatch,       // Shorter without cutting a corner, or sized for another map
+        NoPath          // Not found, though every MovingAI scenario has a path
+    };
+
+    struct ScenarioOutcome {
+        ScenarioVerdict verdict;
+        double cost;
+        size_t expansions;
+        double searchMilliseconds;
+    };
+
+    // Totals of the scenarios of one bucket
+    struct ScenarioBucket {
+        int bucket;
+        int scenarios;
+        int optimal;
+        int cutsCorner;
+        int withinBound;
+        int suboptimal;
+        int mismatch;
+        int noPath;
+        double worstRatio;          // Largest found length over published length
+        size_t expansions;
+        double heuristicMilliseconds;
+        double searchMilliseconds;
+
+        // Scenarios whose paths show a planner or data error
+        int failures() const { return suboptimal + mismatch + noPath; }
+    };
+
+    // Plans every scenario on the map and checks the paths against the published lengths.
+    // Published lengths are for a point robot, keep params.robotRadius at 0 for the check to
+    // mean anything. Buckets come back in ascending order. When outcomes is given it receives
+    // one entry per scenario, in the order of the scenarios.
+    std::vector<ScenarioBucket> runMovingAIScenarios(const Map& map, const std::vector<MovingAIScenario>& scenarios,
+        const PlanParams& params, std::vector<ScenarioOutcome>* outcomes = nullptr);
+}
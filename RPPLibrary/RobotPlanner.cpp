@@ -0,0 +1,296 @@
+#include "RobotPlanner.h"
+#include <algorithm>
+#include <chrono>
+
+
+namespace RPP
+{
+	PlanResult Planner::plan(const Node& start, const Node& goal, const PlanParams& params) {
+		return search(start, goal, params, context_, nullptr);
+	}
+
+	PlanResult Planner::plan(const Node& start, const Node& goal, const PlanParams& params, SearchObserver& observer) {
+		return search(start, goal, params, context_, &observer);
+	}
+
+	PlanResult Planner::plan(const Node& start, const Node& goal, const PlanParams& params, SearchContext& context) const {
+		return search(start, goal, params, context, nullptr);
+	}
+
+	PlanResult Planner::plan(const Node& start, const Node& goal, const PlanParams& params, SearchContext& context, SearchObserver& observer) const {
+		return search(start, goal, params, context, &observer);
+	}
+
+	PlanResult Planner::search(const Node& startNode, const Node& goalNode, const PlanParams& params, SearchContext& context, SearchObserver* observer) const {
+
+		PlanResult result;
+
+		// Validate if start and end nodes are within bounds of the map
+		if (!map_.isInside(startNode.getRow(), startNode.getCol())) {
+			result.status = PlanStatus::InvalidStart;
+			finishSearchStats(result);
+			return result;
+		}
+		if (!map_.isInside(goalNode.getRow(), goalNode.getCol())) {
+			result.status = PlanStatus::InvalidGoal;
+			finishSearchStats(result);
+			return result;
+		}
+
+		// The robot has to fit on both ends, there is no path to look for otherwise
+		if (!map_.robotFits(map_.getIndex(startNode), params.robotRadius)) {
+			result.status = PlanStatus::InvalidStart;
+			finishSearchStats(result);
+			return result;
+		}
+		if (!map_.robotFits(map_.getIndex(goalNode), params.robotRadius)) {
+			result.status = PlanStatus::InvalidGoal;
+			finishSearchStats(result);
+			return result;
+		}
+		const std::chrono::steady_clock::time_point queryStart = std::chrono::steady_clock::now();
+		const bool limited = params.timeLimitMilliseconds > 0.0;
+		const std::chrono::steady_clock::time_point deadline = queryStart +
+			std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(limited ? params.timeLimitMilliseconds : 0.0));
+
+		const int startCell = map_.getIndex(startNode);
+		const int goalCell = map_.getIndex(goalNode);
+#if RPP_SEARCH_STATS
+		const size_t contextBytes = context.getMemoryBytes();
+#endif
+
+		// The traversable layer first, so building it on first use counts as clearance and not as heuristic setup
+		const std::uint64_t* traversable = map_.getTraversable(params.robotRadius);
+		RPP_STATS(result.stats.clearanceMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - queryStart).count());
+
+		// Use the caller's heuristic or prepare one for this goal
+		const Heuristic* heuristic = params.heuristic;
+		if (heuristic == nullptr) {
+			Heuristic& own = context.getHeuristic();
+			own.setMode(params.heuristicMode);
+			own.prepare(map_, goalCell, params.robotRadius);
+			result.heuristicMilliseconds = own.getSetupMilliseconds();
+			heuristic = &own;
+		}
+
+		// The backward side of a bidirectional search needs the same kind of estimate towards the start
+		const Heuristic* reverseHeuristic = nullptr;
+		if (params.engine == SearchEngine::Bidirectional) {
+			Heuristic& reverse = context.getHeuristic(SearchSide::Backward);
+			reverse.setMode(heuristic->getMode());
+			reverse.prepare(map_, startCell, params.robotRadius);
+			result.heuristicMilliseconds += reverse.getSetupMilliseconds();
+			reverseHeuristic = &reverse;
+		}
+
+		std::chrono::steady_clock::time_point searchStart = std::chrono::steady_clock::now();
+		if (limited && searchStart >= deadline) {
+			result.status = PlanStatus::TimedOut;
+			finishSearchStats(result);
+			return result;
+		}
+
+		SearchInput input;
+		input.start = startCell;
+		input.goal = goalCell;
+		input.heuristic = heuristic;
+		input.reverseHeuristic = reverseHeuristic;
+		input.traversable = traversable;
+		input.tieBreak = params.tieBreak;
+		input.weight = std::max(params.weight, 1.0);
+		input.weightStep = params.weightStep;
+		input.expansionLimit = params.expansionLimit;
+		input.limited = limited;
+		input.deadline = deadline;
+		input.observer = observer;
+
+		switch (params.engine) {
+		case SearchEngine::JumpPoint:
+			jumpPointSearch(input, context, result);
+			break;
+		case SearchEngine::Bidirectional:
+			bidirectionalSearch(input, context, result);
+			break;
+		case SearchEngine::Anytime:
+			anytimeSearch(input, context, result);
+			break;
+		default:
+			aStarSearch(input, context, result);
+			break;
+		}
+
+		// If the loop ran dry there is no path from the start node to the goal node, status stays NoPath
+		if (observer && result.found()) {
+			observer->pathFound(result.path, result.cost);
+		}
+		result.searchMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - searchStart).count();
+#if RPP_SEARCH_STATS
+		const size_t contextGrowth = context.getMemoryBytes();
+		result.stats.allocatedBytes = contextGrowth > contextBytes ? contextGrowth - contextBytes : 0;
+#endif
+		finishSearchStats(result);
+		return result;
+	}
+
+	void finishSearchStats(PlanResult& result) {
+		SearchStats& stats = result.stats;
+		stats.found = result.found();
+		stats.expanded = result.expansions;
+		stats.heuristicMilliseconds = result.heuristicMilliseconds;
+		stats.searchMilliseconds = std::max(0.0, result.searchMilliseconds - stats.pathMilliseconds);
+		RPP_STATS(stats.allocatedBytes += result.path.capacity() * sizeof(Node));
+		reportSearchStats(stats);
+	}
+
+	bool Planner::outOfBudget(const SearchInput& input, size_t expansions) {
+		if (input.expansionLimit > 0 && expansions >= input.expansionLimit) {
+			return true;
+		}
+		// Reading the clock every expansion would cost more than the expansion itself
+		return input.limited && (expansions & 255) == 255 && std::chrono::steady_clock::now() >= input.deadline;
+	}
+
+	void Planner::tracePath(const SearchNode* nodes, int goal, PlanResult& result) const {
+#if RPP_SEARCH_STATS
+		const std::chrono::steady_clock::time_point traceStart = std::chrono::steady_clock::now();
+#endif
+		result.status = PlanStatus::Found;
+		result.cost = nodes[goal].gScore;
+		result.path.clear();
+
+		// Parents are adjacent for A*, jump points lie on a straight or diagonal line from theirs
+		int cell = goal;
+		while (cell != -1) {
+			const int parent = nodes[cell].parent;
+			result.path.push_back(map_.getNode(cell));
+			if (parent != -1) {
+				const int rowStep = (map_.getRow(parent) > map_.getRow(cell)) - (map_.getRow(parent) < map_.getRow(cell));
+				const int colStep = (map_.getCol(parent) > map_.getCol(cell)) - (map_.getCol(parent) < map_.getCol(cell));
+				const int step = rowStep * map_.getNumCols() + colStep;
+				for (int between = cell + step; between != parent; between += step) {
+					result.path.push_back(map_.getNode(between));
+				}
+			}
+			cell = parent;
+		}
+		std::reverse(result.path.begin(), result.path.end());
+		RPP_STATS(result.stats.pathMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - traceStart).count());
+	}
+
+	void Planner::aStarSearch(const SearchInput& input, SearchContext& context, PlanResult& result) const {
+
+		const int startCell = input.start;
+		const int goalCell = input.goal;
+		const Heuristic* heuristic = input.heuristic;
+		const std::uint64_t* traversable = input.traversable;
+		const double weight = input.weight;
+		result.suboptimality = weight;
+
+		// A* Search Algorithm
+
+		// 1. Create an empty set of open nodes, open and closed membership is stamped on the nodes for this search
+		const unsigned generation = context.beginSearch(map_, input.tieBreak);
+		SearchNode* nodes = context.getNodes();
+		OpenSet& openSet = context.getOpenSet();
+
+		// 2. Put the starting node on the open list (you can leave its f at zero)
+		SearchNode& start = nodes[startCell];
+		start.heuristic = heuristic->estimate(startCell);
+		start.gScore = 0;
+		start.f = 0;
+		start.parent = -1;
+		start.generation = generation;
+		start.state = SearchState::Open;
+
+		openSet.push(startCell);
+		if (input.observer) {
+			input.observer->nodeOpened(startCell);
+		}
+		RPP_STATS(result.stats.generated = 1, result.stats.peakOpenSize = 1);
+
+		// 3. While open list is not empty
+		while (!openSet.empty()) {
+
+			if (outOfBudget(input, result.expansions)) {
+				result.status = PlanStatus::TimedOut;
+				break;
+			}
+
+			// a) Take the node with the least F off the open list
+			const int current = openSet.pop();
+			++result.expansions;
+			if (input.observer) {
+				input.observer->nodeExpanded(current);
+			}
+
+			// b) Add the current node to the closed set
+			nodes[current].state = SearchState::Closed;
+
+			// c) If we have reached the goal node, reconstruct the path.
+			if (current == goalCell) {
+				tracePath(nodes, current, result);
+				break;
+			}
+
+			const double currentG = nodes[current].gScore;
+
+			// d) Loop through the neighbors of the current node, generated from the grid layout.
+			const NeighborRange neighbors = map_.getNeighbors(current);
+			for (NeighborRange::iterator it = neighbors.begin(); it != neighbors.end(); ++it) {
+
+				const int neighbor = *it;
+				SearchNode& next = nodes[neighbor];
+
+				// Validate which neighbors we can travel to.
+				// If the neighbor is already in the closed set, skip it
+				const SearchState state = next.generation == generation ? next.state : SearchState::Unvisited;
+				if (state == SearchState::Closed) {
+					continue;
+				}
+
+				// Validate that the robot clears every obstacle and doesnt go out of bounds at the neighbor
+				if (!isTraversable(traversable, neighbor)) {
+					continue;
+				}
+
+				// The heuristic is looked up the first time the search reaches a cell, skip cells the goal can not be reached from
+				if (state == SearchState::Unvisited) {
+					next.heuristic = heuristic->estimate(neighbor);
+					if (next.heuristic == HEURISTIC_MAX) {
+						continue;
+					}
+				}
+
+				// Calculate the tentative g score for the neighbor from the length of the step
+				double tentativeGScore = currentG + NEIGHBOR_COST[it.getDirection()];
+
+				// If the neighbor is not in the open set, add it
+				if (state == SearchState::Unvisited) {
+
+					next.generation = generation;
+					next.state = SearchState::Open;
+					next.gScore = tentativeGScore;
+					next.f = next.gScore + weight * next.heuristic;
+					next.parent = current;
+					openSet.push(neighbor);
+					if (input.observer) {
+						input.observer->nodeOpened(neighbor);
+					}
+					RPP_STATS(++result.stats.generated, result.stats.peakOpenSize = std::max(result.stats.peakOpenSize, openSet.size()));
+				}
+				else {
+				// If the neighbor is already in the open set, update its g score if the new score is lower
+					if (tentativeGScore < next.gScore) {
+
+						next.gScore = tentativeGScore;
+						next.f = next.gScore + weight * next.heuristic;
+						next.parent = current;
+						openSet.decreaseKey(neighbor);
+						RPP_STATS(++result.stats.decreaseKeys);
+					}
+				}
+			}
+
+		}
+	}
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include <chrono>
+#include "RobotMap.h"
+#include "RobotHeuristic.h"
+#include "RobotContext.h"
+#include "RobotStats.h"
+
+
+namespace RPP
+{
+	// How the planner explores the grid.
+	enum class SearchEngine {
+		AStar,		// Expands every neighbor of every cell
+		JumpPoint,		// Jump Point Search, skips over runs of symmetric paths and only queues their turning points
+		Bidirectional,	// A* from both ends at once, meeting in the middle
+		Anytime			// ARA*: a quick weighted path first, then better ones while the budget lasts
+	};
+
+	// Options of a single planning query.
+	struct PlanParams {
+		int robotRadius;
+		HeuristicMode heuristicMode;
+		TieBreak tieBreak;
+		SearchEngine engine;
+		// Optional heuristic already prepared for this goal and radius, reused instead of preparing a new one
+		const Heuristic* heuristic;
+		// Wall time budget of the query, 0 for none
+		double timeLimitMilliseconds;
+		// Expansion budget of the query, 0 for none
+		size_t expansionLimit;
+		// Heuristic weight epsilon of the A*, jump point and anytime engines. Above 1 the search
+		// expands fewer cells and returns a path at most this many times longer than the best.
+		double weight;
+		// How much the anytime engine lowers the weight after each path it finds
+		double weightStep;
+
+		PlanParams()
+			:
+			robotRadius(0),
+			heuristicMode(HeuristicMode::Dijkstra),
+			tieBreak(TieBreak::LargerG),
+			engine(SearchEngine::AStar),
+			heuristic(nullptr),
+			timeLimitMilliseconds(0.0),
+			expansionLimit(0),
+			weight(1.0),
+			weightStep(0.5)
+		{}
+	};
+
+	enum class PlanStatus {
+		Found,
+		NoPath,
+		InvalidStart,	// Start is outside the map or the robot does not fit on it
+		InvalidGoal,	// Goal is outside the map or the robot does not fit on it
+		TimedOut,		// The time or expansion budget ran out before a path was found
+		Stale			// Data the planner precomputed from the map is out of date
+	};
+
+	struct PlanResult {
+		PlanStatus status;
+		std::vector<Node> path;		// Start to goal, empty unless found
+		double cost;				// Length of the path
+		double suboptimality;		// The path is at most this many times longer than the best one, 0 when not bounded
+		size_t expansions;			// Cells taken off the open set
+		size_t backwardExpansions;	// Share of the expansions made from the goal side, bidirectional searches only
+		double heuristicMilliseconds;
+		double searchMilliseconds;
+		SearchStats stats;			// The totals above and the finer counters, filled in by finishSearchStats()
+
+		PlanResult()
+			:
+			status(PlanStatus::NoPath),
+			path(),
+			cost(0.0),
+			suboptimality(1.0),
+			expansions(0),
+			backwardExpansions(0),
+			heuristicMilliseconds(0.0),
+			searchMilliseconds(0.0),
+			stats()
+		{}
+
+		bool found() const { return status == PlanStatus::Found; }
+	};
+
+	// Completes result.stats from the totals of the result and reports it to the stats sink.
+	// Every planner calls it once per query, just before returning the result.
+	void finishSearchStats(PlanResult& result);
+
+	// Hook for layers that want to follow a search, such as the console visualizer.
+	// It is called from inside the search loop, so it should only take note and return.
+	class SearchObserver
+	{
+	public:
+		virtual ~SearchObserver() {}
+
+		// The search put this cell on the open set
+		virtual void nodeOpened(int /*cell*/) {}
+		// The search took this cell off the open set
+		virtual void nodeExpanded(int cell) = 0;
+		// An anytime search found a path, shorter than the last one it reported
+		virtual void pathImproved(const std::vector<Node>& /*path*/, double /*cost*/, double /*suboptimality*/) {}
+		// The search is over and found this path
+		virtual void pathFound(const std::vector<Node>& /*path*/, double /*cost*/) {}
+	};
+
+	// Headless A* planner. It never touches the visualizer flags, does no I/O, never
+	// sleeps and reports failures through PlanResult instead of throwing.
+	// The Map is only read. The overloads taking a SearchContext are const and keep all
+	// query state in the context, so threads may share one Planner and one Map as long
+	// as each brings its own context and nobody edits the Map meanwhile.
+	class Planner
+	{
+	public:
+
+		Planner(const Map& map)
+			:
+			map_(map),
+			context_()
+		{}
+
+		// Plan with the planner's own context, one query at a time
+		PlanResult plan(const Node& start, const Node& goal, const PlanParams& params);
+		// Same search, reporting every expansion to the observer
+		PlanResult plan(const Node& start, const Node& goal, const PlanParams& params, SearchObserver& observer);
+
+		// Plan with a caller owned context, safe to run concurrently with other contexts
+		PlanResult plan(const Node& start, const Node& goal, const PlanParams& params, SearchContext& context) const;
+		PlanResult plan(const Node& start, const Node& goal, const PlanParams& params, SearchContext& context, SearchObserver& observer) const;
+
+		const Map& getMap() const { return map_; }
+
+	private:
+		const Map& map_;
+		SearchContext context_;
+
+		// What the engines need once the query is validated and its heuristic prepared
+		struct SearchInput {
+			int start;
+			int goal;
+			const Heuristic* heuristic;
+			const Heuristic* reverseHeuristic;	// Estimates the distance to the start, bidirectional searches only
+			const std::uint64_t* traversable;	// Cells the robot fits on, see Map::getTraversable
+			TieBreak tieBreak;
+			double weight;
+			double weightStep;
+			size_t expansionLimit;
+			bool limited;
+			std::chrono::steady_clock::time_point deadline;
+			SearchObserver* observer;
+		};
+
+		PlanResult search(const Node& start, const Node& goal, const PlanParams& params, SearchContext& context, SearchObserver* observer) const;
+		void aStarSearch(const SearchInput& input, SearchContext& context, PlanResult& result) const;
+		void jumpPointSearch(const SearchInput& input, SearchContext& context, PlanResult& result) const;
+		void bidirectionalSearch(const SearchInput& input, SearchContext& context, PlanResult& result) const;
+		void anytimeSearch(const SearchInput& input, SearchContext& context, PlanResult& result) const;
+		// Next jump point from the cell in the direction, -1 when the line runs into a wall first
+		int jump(const SearchInput& input, int row, int col, int rowStep, int colStep) const;
+		bool walkable(const SearchInput& input, int row, int col) const {
+			return map_.isInside(row, col) && isTraversable(input.traversable, map_.getIndex(row, col));
+		}
+
+		// True once the time or expansion budget is spent
+		static bool outOfBudget(const SearchInput& input, size_t expansions);
+		// Fills in the result from the goal's parent chain
+		void tracePath(const SearchNode* nodes, int goal, PlanResult& result) const;
+
+	};
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include <vector>
+#include <utility>
+
+namespace RPP
+{
+    // Indexed d-ary min-heap used as the A* open set.
+    // Every item remembers its own slot in the heap through the Slot policy
+    // (get(item) / set(item, slot)), which gives O(1) membership tests and a
+    // real O(log n) decreaseKey instead of a linear search of the open set.
+    // A slot of -1 means "not in the heap".
+    template <typename Item, typename Less, typename Slot, int Arity = 4>
+    class IndexedHeap {
+
+        static_assert(Arity >= 2, "Heap arity must be at least two");
+
+        public:
+
+            IndexedHeap(Less less = Less(), Slot slot = Slot())
+                :
+                heap_(),
+                less_(less),
+                slot_(slot)
+            {}
+
+            // Leaves no item pointing at a heap that no longer exists.
+            ~IndexedHeap() { clear(); }
+
+            IndexedHeap(const IndexedHeap&) = delete;
+            IndexedHeap& operator=(const IndexedHeap&) = delete;
+
+            // Getters
+            bool empty() const { return heap_.empty(); }
+            size_t size() const { return heap_.size(); }
+            size_t capacity() const { return heap_.capacity(); }
+            const Item& top() const { return heap_.front(); }
+            bool contains(const Item& item) const { return slot_.get(item) >= 0; }
+            // Items in heap order, for callers that need to visit every queued item
+            const std::vector<Item>& getItems() const { return heap_; }
+
+            void setLess(Less less) { less_ = less; }
+            void setSlot(Slot slot) { slot_ = slot; }
+            void reserve(size_t capacity) { heap_.reserve(capacity); }
+
+            // Member Functions
+            void push(const Item& item) {
+                heap_.push_back(item);
+                siftUp(heap_.size() - 1);
+            }
+
+            Item pop() {
+                Item result = heap_.front();
+                slot_.set(result, -1);
+                Item last = heap_.back();
+                heap_.pop_back();
+                if (!heap_.empty()) {
+                    heap_.front() = last;
+                    siftDown(0);
+                }
+                return result;
+            }
+
+            // The item's key got smaller, move it towards the root.
+            void decreaseKey(const Item& item) {
+                siftUp(static_cast<size_t>(slot_.get(item)));
+            }
+
+            // The item's key changed in an unknown direction.
+            void update(const Item& item) {
+                size_t index = static_cast<size_t>(slot_.get(item));
+                siftUp(index);
+                siftDown(static_cast<size_t>(slot_.get(item)));
+            }
+
+            void remove(const Item& item) {
+                size_t index = static_cast<size_t>(slot_.get(item));
+                slot_.set(item, -1);
+                Item last = heap_.back();
+                heap_.pop_back();
+                if (index < heap_.size()) {
+                    heap_[index] = last;
+                    siftUp(index);
+                    siftDown(static_cast<size_t>(slot_.get(last)));
+                }
+            }
+
+            // The keys of many items changed at once, restore the heap order in O(n).
+            void rebuild() {
+                for (size_t index = heap_.size() / Arity + 1; index-- > 0;) {
+                    if (index < heap_.size()) {
+                        siftDown(index);
+                    }
+                }
+            }
+
+            // Empties the heap and marks every remaining item as not queued.
+            void clear() {
+                for (const Item& item : heap_) {
+                    slot_.set(item, -1);
+                }
+                heap_.clear();
+            }
+
+        private:
+
+            std::vector<Item> heap_;
+            Less less_;
+            Slot slot_;
+
+            void place(size_t index, const Item& item) {
+                heap_[index] = item;
+                slot_.set(item, static_cast<int>(index));
+            }
+
+            void siftUp(size_t index) {
+                Item item = heap_[index];
+                while (index > 0) {
+                    size_t parent = (index - 1) / Arity;
+                    if (!less_(item, heap_[parent])) {
+                        break;
+                    }
+                    place(index, heap_[parent]);
+                    index = parent;
+                }
+                place(index, item);
+            }
+
+            void siftDown(size_t index) {
+                Item item = heap_[index];
+                const size_t count = heap_.size();
+                while (true) {
+                    size_t first = index * Arity + 1;
+                    if (first >= count) {
+                        break;
+                    }
+                    size_t last = first + Arity < count ? first + Arity : count;
+                    size_t best = first;
+                    for (size_t child = first + 1; child < last; ++child) {
+                        if (less_(heap_[child], heap_[best])) {
+                            best = child;
+                        }
+                    }
+                    if (!less_(heap_[best], item)) {
+                        break;
+                    }
+                    place(index, heap_[best]);
+                    index = best;
+                }
+                place(index, item);
+            }
+    };
+}
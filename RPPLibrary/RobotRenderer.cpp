@@ -0,0 +1,264 @@
+#include "RobotRenderer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+
+namespace RPP
+{
+	namespace
+	{
+		// What the search did to a cell, as the renderer saw it
+		enum RenderFlag : unsigned char {
+			RENDER_OPENED = 1 << 0,
+			RENDER_TRAIL = 1 << 1,		// Under the robot when it expanded a cell nearby
+			RENDER_BEST_PATH = 1 << 2
+		};
+	}
+
+	SearchRenderer::SearchRenderer(const Map& map, int start, int goal, int robotRadius, std::ostream& os)
+		:
+		map_(map),
+		start_(start),
+		goal_(goal),
+		robotRadius_(robotRadius),
+		os_(os),
+		framesPerSecond_(30.0),
+		recording_(false),
+		ring_(),
+		writer_(*this),
+		thread_(),
+		running_(false),
+		cells_(),
+		pendingPath_(),
+		bestPath_(),
+		recorded_(),
+		robot_(start),
+		opened_(0),
+		expanded_(0),
+		pathCost_(0.0),
+		frames_(0),
+		frame_()
+	{}
+
+	SearchRenderer::~SearchRenderer() {
+		finish();
+	}
+
+	void SearchRenderer::start() {
+		if (running_) {
+			return;
+		}
+		cells_.assign(static_cast<size_t>(map_.getNumCells()), 0);
+		pendingPath_.clear();
+		bestPath_.clear();
+		if (recording_) {
+			recorded_.clear();
+		}
+		robot_ = start_;
+		opened_ = 0;
+		expanded_ = 0;
+		pathCost_ = 0.0;
+		frames_ = 0;
+		frame_.invalidate();
+		running_ = true;
+		thread_ = std::thread(&SearchRenderer::run, this);
+	}
+
+	void SearchRenderer::finish() {
+		if (!running_) {
+			return;
+		}
+		sendWaiting(SearchEvent(SearchEventType::SearchDone));
+		thread_.join();
+		running_ = false;
+	}
+
+	void SearchRenderer::replay(const std::vector<SearchEvent>& events) {
+		const bool recording = recording_;
+		recording_ = false;
+		start();
+		for (const SearchEvent& event : events) {
+			if (event.type != SearchEventType::SearchDone) {
+				sendWaiting(event);
+			}
+		}
+		finish();
+		recording_ = recording;
+	}
+
+	void SearchRenderer::sendWaiting(const SearchEvent& event) {
+		while (!ring_.push(event)) {
+			std::this_thread::yield();
+		}
+	}
+
+	void SearchRenderer::EventWriter::sendPath(const std::vector<Node>& path, double cost) {
+		// Without the renderer thread nobody would make room
+		if (!renderer_.running_) {
+			dropped_.fetch_add(path.size() + 1, std::memory_order_relaxed);
+			return;
+		}
+		for (const Node& node : path) {
+			renderer_.sendWaiting(SearchEvent(SearchEventType::PathNode, renderer_.map_.getIndex(node)));
+		}
+		renderer_.sendWaiting(SearchEvent(SearchEventType::PathFound, -1, cost));
+	}
+
+	void SearchRenderer::run() {
+		typedef std::chrono::steady_clock Clock;
+		const Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+			std::chrono::duration<double>(framesPerSecond_ > 0.0 ? 1.0 / framesPerSecond_ : 0.0));
+		Clock::time_point nextFrame = Clock::now();
+		bool done = false;
+		while (!done) {
+			const bool busy = drain(done);
+			const Clock::time_point now = Clock::now();
+			if (done || now >= nextFrame) {
+				drawFrame();
+				nextFrame = now + period;
+			}
+			else if (!busy) {
+				// Nothing to do until the search sends more or the next frame is due
+				std::this_thread::sleep_for(std::min<Clock::duration>(nextFrame - now, std::chrono::milliseconds(1)));
+			}
+		}
+	}
+
+	bool SearchRenderer::drain(bool& done) {
+		// Stop after a ring's worth so a search that outpaces us still gets its frames drawn
+		size_t taken = 0;
+		SearchEvent event;
+		while (taken < ring_.getCapacity() && ring_.pop(event)) {
+			++taken;
+			if (event.type == SearchEventType::SearchDone) {
+				done = true;
+				break;
+			}
+			apply(event);
+			if (recording_) {
+				recorded_.push_back(event);
+			}
+		}
+		return taken > 0;
+	}
+
+	void SearchRenderer::apply(const SearchEvent& event) {
+		switch (event.type) {
+		case SearchEventType::NodeOpened:
+			cells_[event.cell] |= RENDER_OPENED;
+			++opened_;
+			break;
+		case SearchEventType::NodeExpanded: {
+			// Leave a trail under the robot, the disc of its radius around the cell
+			robot_ = event.cell;
+			++expanded_;
+			const int centerRow = map_.getRow(event.cell);
+			const int centerCol = map_.getCol(event.cell);
+			for (int row = std::max(0, centerRow - robotRadius_); row <= std::min(map_.getNumRows() - 1, centerRow + robotRadius_); ++row) {
+				for (int col = std::max(0, centerCol - robotRadius_); col <= std::min(map_.getNumCols() - 1, centerCol + robotRadius_); ++col) {
+					const int dRow = row - centerRow;
+					const int dCol = col - centerCol;
+					if (dRow * dRow + dCol * dCol <= robotRadius_ * robotRadius_) {
+						cells_[map_.getIndex(row, col)] |= RENDER_TRAIL;
+					}
+				}
+			}
+			break;
+		}
+		case SearchEventType::PathNode:
+			pendingPath_.push_back(event.cell);
+			break;
+		case SearchEventType::PathFound:
+			// A shorter path replaces the one drawn so far
+			for (int cell : bestPath_) {
+				cells_[cell] &= ~RENDER_BEST_PATH;
+			}
+			bestPath_.swap(pendingPath_);
+			pendingPath_.clear();
+			for (int cell : bestPath_) {
+				cells_[cell] |= RENDER_BEST_PATH;
+			}
+			pathCost_ = event.value;
+			break;
+		default:
+			break;
+		}
+	}
+
+	void SearchRenderer::drawFrame() {
+
+		// Same layout as Map::printToConsole, redrawn in place: only the changed cells go out, in one write
+		const int numRows = map_.getNumRows();
+		const int numCols = map_.getNumCols();
+		const int labelWidth = std::max(2, static_cast<int>(std::to_string(std::max(numRows - 1, 0)).size()));
+		const int left = labelWidth + 2;
+		frame_.begin(numRows + 4, std::max(left + 6 * numCols, 80));
+		frame_.put(0, 0, "Search Map:");
+
+		const int robotRow = map_.getRow(robot_);
+		const int robotCol = map_.getCol(robot_);
+		char text[96];
+		for (int row = 0; row < numRows; ++row) {
+			const int line = row + 1;
+			std::snprintf(text, sizeof(text), "%d", row);
+			frame_.putRight(line, 0, labelWidth, text);
+			frame_.put(line, labelWidth, "| ");
+			for (int col = 0; col < numCols; ++col) {
+				const int cell = map_.getIndex(row, col);
+				const int dRow = row - robotRow;
+				const int dCol = col - robotCol;
+				const char* mark = " 0  ";
+				ConsoleColor color = ConsoleColor::Default;
+				if (map_.isObstacle(cell)) {
+					mark = " 1  ";
+					color = ConsoleColor::Red;
+				}
+				else if (cell == start_) {
+					color = ConsoleColor::Blue;
+				}
+				else if (cell == goal_) {
+					color = ConsoleColor::Green;
+				}
+				else if (dRow * dRow + dCol * dCol <= robotRadius_ * robotRadius_) {
+					mark = " 1  ";
+					color = ConsoleColor::Yellow;
+				}
+				else if (cells_[cell] & RENDER_BEST_PATH) {
+					color = ConsoleColor::Magenta;
+				}
+				else if (cells_[cell] & RENDER_TRAIL) {
+					color = ConsoleColor::Cyan;
+				}
+				else if (cells_[cell] & RENDER_OPENED) {
+					color = ConsoleColor::Grey;
+				}
+				frame_.putRight(line, left + 6 * col, 6, mark, color);
+			}
+		}
+
+		// Print the column numbers
+		frame_.put(numRows + 1, labelWidth, "+");
+		for (int col = 0; col < numCols; ++col) {
+			frame_.put(numRows + 1, left - 1 + 6 * col, "   ---");
+			std::snprintf(text, sizeof(text), "%d", col);
+			frame_.putRight(numRows + 2, left - 2 + 6 * col, 6, text);
+		}
+
+		int length = std::snprintf(text, sizeof(text), "Expanded %zu, opened %zu", expanded_, opened_);
+		if (!bestPath_.empty()) {
+			length += std::snprintf(text + length, sizeof(text) - length, ", path length %g", pathCost_);
+		}
+		const size_t dropped = writer_.getDropped();
+		if (dropped > 0) {
+			std::snprintf(text + length, sizeof(text) - length, ", %zu events dropped", dropped);
+		}
+		frame_.put(numRows + 3, 0, text);
+
+		const std::string& output = frame_.diff();
+		os_.write(output.data(), static_cast<std::streamsize>(output.size()));
+		os_.flush();
+		++frames_;
+	}
+}
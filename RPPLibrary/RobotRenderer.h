@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "RobotMap.h"
+#include "RobotPlanner.h"
+#include "RobotEvents.h"
+#include "RobotConsole.h"
+
+
+namespace RPP
+{
+	// Draws a search on the console from a thread of its own. The search reports to
+	// getObserver(), which only drops events into a lock-free ring, and the renderer thread
+	// takes them out as fast as they come and redraws the map a fixed number of times a second.
+	// Frames are redrawn in place, only the cells that changed go out.
+	// The search runs at full speed however slow the console is. Expansion events that find
+	// the ring full are dropped and counted, path events wait for room.
+	//
+	// The map is only read, and must not change while the renderer runs.
+	class SearchRenderer
+	{
+	public:
+
+		SearchRenderer(const Map& map, int start, int goal, int robotRadius, std::ostream& os = std::cout);
+		// Finishes the rendering if finish() was not called
+		~SearchRenderer();
+
+		SearchRenderer(const SearchRenderer&) = delete;
+		SearchRenderer& operator=(const SearchRenderer&) = delete;
+
+		// Setters, before start()
+		void setFrameRate(double framesPerSecond) { framesPerSecond_ = framesPerSecond; }
+		// Keeps every event the renderer takes out of the ring, see getRecording()
+		void setRecording(bool recording) { recording_ = recording; }
+
+		// Starts the renderer thread
+		void start();
+		// Pass this to Planner::plan() between start() and finish()
+		SearchObserver& getObserver() { return writer_; }
+		// Waits for the events still in the ring, draws the last frame and stops the thread
+		void finish();
+		// Draws a recorded run as if a search were sending it now
+		void replay(const std::vector<SearchEvent>& events);
+
+		// Getters, valid after finish()
+		const std::vector<SearchEvent>& getRecording() const { return recorded_; }
+		size_t getFrames() const { return frames_; }
+		size_t getDroppedEvents() const { return writer_.getDropped(); }
+
+	private:
+
+		// Turns observer calls into events, runs on the search thread
+		class EventWriter : public SearchObserver
+		{
+		public:
+			EventWriter(SearchRenderer& renderer) : renderer_(renderer), dropped_(0) {}
+
+			void nodeOpened(int cell) override { send(SearchEvent(SearchEventType::NodeOpened, cell)); }
+			void nodeExpanded(int cell) override { send(SearchEvent(SearchEventType::NodeExpanded, cell)); }
+			void pathImproved(const std::vector<Node>& path, double cost, double /*suboptimality*/) override { sendPath(path, cost); }
+			void pathFound(const std::vector<Node>& path, double cost) override { sendPath(path, cost); }
+
+			size_t getDropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+		private:
+			SearchRenderer& renderer_;
+			std::atomic<size_t> dropped_;
+
+			void send(const SearchEvent& event) {
+				if (!renderer_.ring_.push(event)) {
+					dropped_.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+			void sendPath(const std::vector<Node>& path, double cost);
+		};
+
+		const Map& map_;
+		int start_;
+		int goal_;
+		int robotRadius_;
+		std::ostream& os_;
+		double framesPerSecond_;
+		bool recording_;
+
+		SearchEventRing ring_;
+		EventWriter writer_;
+		std::thread thread_;
+		bool running_;
+
+		// Renderer thread state
+		std::vector<unsigned char> cells_;	// What the search did to each cell so far
+		std::vector<int> pendingPath_;		// Path nodes waiting for their PathFound
+		std::vector<int> bestPath_;
+		std::vector<SearchEvent> recorded_;
+		int robot_;
+		size_t opened_;
+		size_t expanded_;
+		double pathCost_;
+		size_t frames_;
+		ConsoleFrame frame_;				// What the last frame left on the screen
+
+		// Waits for room in the ring, for the few events that must not be lost
+		void sendWaiting(const SearchEvent& event);
+		void run();
+		// Applies what is in the ring, up to one ring's worth. Returns false if it was empty.
+		bool drain(bool& done);
+		void apply(const SearchEvent& event);
+		void drawFrame();
+
+	};
+}
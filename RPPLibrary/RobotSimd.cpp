@@ -0,0 +1,269 @@
+#include "RobotSimd.h"
+#include <algorithm>
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RPP_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define RPP_SIMD_X86 0
+#endif
+
+// MSVC compiles any intrinsic anywhere, GCC and Clang want the functions using them marked
+#if RPP_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#define RPP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define RPP_TARGET_AVX2
+#endif
+
+
+namespace RPP
+{
+    namespace
+    {
+        inline bool isOccupied(const std::uint64_t* occupancy, std::size_t bit) {
+            return (occupancy[bit >> 6] >> (bit & 63)) & 1;
+        }
+
+        // Scalar kernels, the reference the vector ones have to match
+
+        void thresholdBitsScalar(const int* values, std::size_t count, int threshold, std::uint64_t* bits) {
+            for (std::size_t first = 0; first < count; first += 64) {
+                const std::size_t last = std::min(count, first + 64);
+                std::uint64_t word = 0;
+                for (std::size_t i = first; i < last; ++i) {
+                    if (values[i] > threshold) {
+                        word |= std::uint64_t(1) << (i - first);
+                    }
+                }
+                bits[first >> 6] = word;
+            }
+        }
+
+        void maskObstaclesScalar(const std::uint64_t* occupancy, std::size_t firstBit, int count, int freeValue, int* out) {
+            for (int i = 0; i < count; ++i) {
+                out[i] = isOccupied(occupancy, firstBit + i) ? 0 : freeValue;
+            }
+        }
+
+        void columnDownScalar(const std::uint64_t* occupancy, std::size_t firstBit, int count, const int* previous, int* gaps) {
+            for (int i = 0; i < count; ++i) {
+                gaps[i] = isOccupied(occupancy, firstBit + i) ? 0 : std::min(previous[i] + 1, COLUMN_GAP_NONE);
+            }
+        }
+
+        void columnUpScalar(int row, int count, int* gaps, int* running, int* sites) {
+            for (int i = 0; i < count; ++i) {
+                const int down = gaps[i];
+                const int up = down == 0 ? 0 : std::min(running[i] + 1, COLUMN_GAP_NONE);
+                const int best = std::min(down, up);
+                running[i] = up;
+                gaps[i] = best;
+                if (sites) {
+                    sites[i] = best == COLUMN_GAP_NONE ? -1 : (down == best ? row - down : row + up);
+                }
+            }
+        }
+
+        inline void chamferCell(const int* adjacent, int count, int* line, int i) {
+            int closest = adjacent[i];
+            if (i > 0) {
+                closest = std::min(closest, adjacent[i - 1]);
+            }
+            if (i < count - 1) {
+                closest = std::min(closest, adjacent[i + 1]);
+            }
+            line[i] = std::min(line[i], closest + 1);
+        }
+
+        void chamferRowScalar(const int* adjacent, int count, int* line) {
+            for (int i = 0; i < count; ++i) {
+                chamferCell(adjacent, count, line, i);
+            }
+        }
+
+        void squareHopsScalar(int* values, std::size_t count, int far) {
+            for (std::size_t i = 0; i < count; ++i) {
+                values[i] = values[i] >= far ? INT_MAX : values[i] * values[i];
+            }
+        }
+
+        const GridKernels SCALAR_KERNELS = {
+            thresholdBitsScalar,
+            maskObstaclesScalar,
+            columnDownScalar,
+            columnUpScalar,
+            chamferRowScalar,
+            squareHopsScalar
+        };
+
+#if RPP_SIMD_X86
+        // AVX2 kernels, eight cells per step and the scalar kernel for what is left of the row
+
+        // All ones in the lanes whose occupancy bit is set, for the eight bits from bit on
+        RPP_TARGET_AVX2 inline __m256i obstacleLanes(const std::uint64_t* occupancy, std::size_t bit) {
+            const std::size_t shift = bit & 63;
+            std::uint64_t word = occupancy[bit >> 6] >> shift;
+            if (shift > 56) {
+                word |= occupancy[(bit >> 6) + 1] << (64 - shift);
+            }
+            const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+            return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<int>(word & 0xFF)), lanes), lanes);
+        }
+
+        RPP_TARGET_AVX2 void thresholdBitsAVX2(const int* values, std::size_t count, int threshold, std::uint64_t* bits) {
+            const __m256i limit = _mm256_set1_epi32(threshold);
+            const std::size_t words = count / 64;
+            for (std::size_t w = 0; w < words; ++w) {
+                const int* chunk = values + w * 64;
+                std::uint64_t word = 0;
+                for (int part = 0; part < 8; ++part) {
+                    const __m256i above = _mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(chunk + part * 8)), limit);
+                    word |= static_cast<std::uint64_t>(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(above)))) << (part * 8);
+                }
+                bits[w] = word;
+            }
+            thresholdBitsScalar(values + words * 64, count - words * 64, threshold, bits + words);
+        }
+
+        RPP_TARGET_AVX2 void maskObstaclesAVX2(const std::uint64_t* occupancy, std::size_t firstBit, int count, int freeValue, int* out) {
+            const __m256i free = _mm256_set1_epi32(freeValue);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_andnot_si256(obstacleLanes(occupancy, firstBit + i), free));
+            }
+            maskObstaclesScalar(occupancy, firstBit + i, count - i, freeValue, out + i);
+        }
+
+        RPP_TARGET_AVX2 void columnDownAVX2(const std::uint64_t* occupancy, std::size_t firstBit, int count, const int* previous, int* gaps) {
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256i none = _mm256_set1_epi32(COLUMN_GAP_NONE);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                const __m256i above = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(previous + i));
+                const __m256i gap = _mm256_min_epi32(_mm256_add_epi32(above, one), none);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(gaps + i), _mm256_andnot_si256(obstacleLanes(occupancy, firstBit + i), gap));
+            }
+            columnDownScalar(occupancy, firstBit + i, count - i, previous + i, gaps + i);
+        }
+
+        RPP_TARGET_AVX2 void columnUpAVX2(int row, int count, int* gaps, int* running, int* sites) {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256i none = _mm256_set1_epi32(COLUMN_GAP_NONE);
+            const __m256i rows = _mm256_set1_epi32(row);
+            const __m256i missing = _mm256_set1_epi32(-1);
+            int i = 0;
+            for (; i + 8 <= count; i += 8) {
+                const __m256i down = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(gaps + i));
+                const __m256i below = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(running + i));
+                const __m256i up = _mm256_andnot_si256(_mm256_cmpeq_epi32(down, zero), _mm256_min_epi32(_mm256_add_epi32(below, one), none));
+                const __m256i best = _mm256_min_epi32(down, up);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(running + i), up);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(gaps + i), best);
+                if (sites) {
+                    __m256i site = _mm256_blendv_epi8(_mm256_add_epi32(rows, up), _mm256_sub_epi32(rows, down), _mm256_cmpeq_epi32(down, best));
+                    site = _mm256_blendv_epi8(site, missing, _mm256_cmpeq_epi32(best, none));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(sites + i), site);
+                }
+            }
+            columnUpScalar(row, count - i, gaps + i, running + i, sites ? sites + i : nullptr);
+        }
+
+        RPP_TARGET_AVX2 void chamferRowAVX2(const int* adjacent, int count, int* line) {
+            // The first and last cells have a neighbor missing, only whole windows of three go through the vector loop
+            const __m256i one = _mm256_set1_epi32(1);
+            int i = 0;
+            if (count > 0) {
+                chamferCell(adjacent, count, line, i++);
+            }
+            for (; i + 8 < count; i += 8) {
+                const __m256i left = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(adjacent + i - 1));
+                const __m256i middle = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(adjacent + i));
+                const __m256i right = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(adjacent + i + 1));
+                const __m256i closest = _mm256_add_epi32(_mm256_min_epi32(_mm256_min_epi32(left, middle), right), one);
+                __m256i* target = reinterpret_cast<__m256i*>(line + i);
+                _mm256_storeu_si256(target, _mm256_min_epi32(_mm256_loadu_si256(target), closest));
+            }
+            for (; i < count; ++i) {
+                chamferCell(adjacent, count, line, i);
+            }
+        }
+
+        RPP_TARGET_AVX2 void squareHopsAVX2(int* values, std::size_t count, int far) {
+            const __m256i lastHop = _mm256_set1_epi32(far - 1);
+            const __m256i unreached = _mm256_set1_epi32(INT_MAX);
+            std::size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256i* target = reinterpret_cast<__m256i*>(values + i);
+                const __m256i hops = _mm256_loadu_si256(target);
+                _mm256_storeu_si256(target, _mm256_blendv_epi8(_mm256_mullo_epi32(hops, hops), unreached, _mm256_cmpgt_epi32(hops, lastHop)));
+            }
+            squareHopsScalar(values + i, count - i, far);
+        }
+
+        const GridKernels AVX2_KERNELS = {
+            thresholdBitsAVX2,
+            maskObstaclesAVX2,
+            columnDownAVX2,
+            columnUpAVX2,
+            chamferRowAVX2,
+            squareHopsAVX2
+        };
+#endif
+
+        SimdLevel detectSimdLevel() {
+#if RPP_SIMD_X86 && defined(_MSC_VER)
+            // AVX2 needs the instructions and an OS that saves the YMM registers on context switches
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) {
+                return SimdLevel::Scalar;
+            }
+            __cpuid(info, 1);
+            const bool osSavesRegisters = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osSavesRegisters || !avx || (_xgetbv(0) & 6) != 6) {
+                return SimdLevel::Scalar;
+            }
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0 ? SimdLevel::AVX2 : SimdLevel::Scalar;
+#elif RPP_SIMD_X86
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::Scalar;
+#else
+            return SimdLevel::Scalar;
+#endif
+        }
+
+        std::atomic<int>& activeLevel() {
+            static std::atomic<int> level(static_cast<int>(getSupportedSimdLevel()));
+            return level;
+        }
+    }
+
+    SimdLevel getSupportedSimdLevel() {
+        static const SimdLevel supported = detectSimdLevel();
+        return supported;
+    }
+
+    SimdLevel getSimdLevel() {
+        return static_cast<SimdLevel>(activeLevel().load());
+    }
+
+    void setSimdLevel(SimdLevel level) {
+        activeLevel().store(static_cast<int>(std::min(level, getSupportedSimdLevel())));
+    }
+
+    const GridKernels& getGridKernels() {
+#if RPP_SIMD_X86
+        if (getSimdLevel() == SimdLevel::AVX2) {
+            return AVX2_KERNELS;
+        }
+#endif
+        return SCALAR_KERNELS;
+    }
+}
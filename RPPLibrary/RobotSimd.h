@@ -0,0 +1,48 @@
+#pragma once
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+namespace RPP
+{
+    // Instruction sets the grid kernels come in, from least to most capable.
+    enum class SimdLevel {
+        Scalar,     // Plain C++, runs anywhere
+        AVX2        // Eight 32-bit lanes, x86 with AVX2 and an OS that saves the registers
+    };
+
+    // Column distance of a cell with no obstacle in its column yet. Adding one to it does
+    // not overflow and the min keeps it in place, so the kernels need no special case for it.
+    const int COLUMN_GAP_NONE = INT_MAX - 1;
+
+    // The inner loops of the clearance and inflation passes. They work on whole rows of the
+    // flat grid at a time and take the occupancy bitmap as a bit offset into its words.
+    // Every level produces exactly the same output, the vector kernels only do it faster.
+    struct GridKernels {
+        // bits[i / 64] bit i % 64 set where values[i] > threshold, for all (count + 63) / 64 words
+        void (*thresholdBits)(const int* values, std::size_t count, int threshold, std::uint64_t* bits);
+        // out[i] = 0 where the occupancy bit firstBit + i is set, freeValue elsewhere
+        void (*maskObstacles)(const std::uint64_t* occupancy, std::size_t firstBit, int count, int freeValue, int* out);
+        // Down a row of columns: gaps[i] = 0 on obstacles, else min(previous[i] + 1, COLUMN_GAP_NONE)
+        void (*columnDown)(const std::uint64_t* occupancy, std::size_t firstBit, int count, const int* previous, int* gaps);
+        // Back up a row of columns. gaps holds the columnDown() result and receives the gap to the
+        // closer obstacle above or below, running the gap to the closest one below. When given,
+        // sites receives the row of that obstacle, the one above on ties, or -1 for none.
+        void (*columnUp)(int row, int count, int* gaps, int* running, int* sites);
+        // Chamfer step from the row above or below: line[i] = min(line[i], 1 + min(adjacent[i - 1 .. i + 1]))
+        void (*chamferRow)(const int* adjacent, int count, int* line);
+        // Hop counts to squared distances: values[i] = values[i] >= far ? INT_MAX : values[i] * values[i]
+        void (*squareHops)(int* values, std::size_t count, int far);
+    };
+
+    // Best level the processor supports
+    SimdLevel getSupportedSimdLevel();
+    // Level in use, the supported one unless setSimdLevel() asked for less
+    SimdLevel getSimdLevel();
+    // Picks the kernels of a level, capped at the supported one. Meant for checking the
+    // vector kernels against the scalar ones, call it while no transform is running.
+    void setSimdLevel(SimdLevel level);
+
+    // Kernels of the level in use
+    const GridKernels& getGridKernels();
+}
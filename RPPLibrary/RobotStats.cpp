@@ -0,0 +1,35 @@
+#include "RobotStats.h"
+#include <atomic>
+
+
+namespace RPP
+{
+#if RPP_SEARCH_STATS
+	namespace
+	{
+		std::atomic<SearchStatsSink*> statsSink(nullptr);
+		std::atomic<unsigned> statsSampleEvery(1);
+		std::atomic<unsigned> statsQueries(0);
+	}
+
+	void setSearchStatsSink(SearchStatsSink* sink, unsigned sampleEvery) {
+		statsSampleEvery.store(sampleEvery > 0 ? sampleEvery : 1, std::memory_order_relaxed);
+		statsQueries.store(0, std::memory_order_relaxed);
+		statsSink.store(sink, std::memory_order_release);
+	}
+
+	void reportSearchStats(const SearchStats& stats) {
+		// Without a sink a query only pays for this load
+		SearchStatsSink* sink = statsSink.load(std::memory_order_acquire);
+		if (sink == nullptr) {
+			return;
+		}
+		const unsigned every = statsSampleEvery.load(std::memory_order_relaxed);
+		if (every == 1 || statsQueries.fetch_add(1, std::memory_order_relaxed) % every == 0) {
+			sink->record(stats);
+		}
+	}
+#else
+	void setSearchStatsSink(SearchStatsSink*, unsigned) {}
+#endif
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+
+// Build with RPP_SEARCH_STATS=0 to compile the search counters and the stats sink out of the
+// planners. The fields then stay zero, except the ones PlanResult has always kept.
+#ifndef RPP_SEARCH_STATS
+#define RPP_SEARCH_STATS 1
+#endif
+
+#if RPP_SEARCH_STATS
+#define RPP_STATS(...) do { __VA_ARGS__; } while (0)
+#else
+#define RPP_STATS(...) do {} while (0)
+#endif
+
+
+namespace RPP
+{
+	// What one query cost, counter by counter and phase by phase. The phases do not overlap,
+	// their sum is the wall time of the query.
+	struct SearchStats {
+		bool found;
+		size_t expanded;			// Nodes taken off the open set
+		size_t generated;			// Nodes put on the open set for the first time
+		size_t reopened;			// Closed nodes put back on the open set after they got cheaper
+		size_t decreaseKeys;		// Open nodes moved up the open set after they got cheaper
+		size_t peakOpenSize;		// Most nodes on the open set at once, both sides for bidirectional searches
+		size_t allocatedBytes;		// Growth of the search context plus the returned path
+		double clearanceMilliseconds;	// Fetching, or on first use building, the traversable layer of the radius
+		double heuristicMilliseconds;
+		double searchMilliseconds;		// Expanding nodes, without the path reconstruction
+		double pathMilliseconds;		// Tracing the path back through the parents
+
+		SearchStats()
+			:
+			found(false),
+			expanded(0),
+			generated(0),
+			reopened(0),
+			decreaseKeys(0),
+			peakOpenSize(0),
+			allocatedBytes(0),
+			clearanceMilliseconds(0.0),
+			heuristicMilliseconds(0.0),
+			searchMilliseconds(0.0),
+			pathMilliseconds(0.0)
+		{}
+	};
+
+	// Receives the stats of sampled queries, for example to feed a metrics pipeline. It is called
+	// on the thread that ran the query, so it has to be thread safe when planners run in parallel,
+	// and it should be quick: the query does not return before it does.
+	class SearchStatsSink
+	{
+	public:
+		virtual ~SearchStatsSink() {}
+
+		virtual void record(const SearchStats& stats) = 0;
+	};
+
+	// Sends the stats of every sampleEvery-th query of the process to the sink, nullptr stops.
+	// The sink has to outlive every query that may still be running. Without RPP_SEARCH_STATS
+	// this does nothing.
+	void setSearchStatsSink(SearchStatsSink* sink, unsigned sampleEvery = 1);
+
+	// Hands the stats of a finished query to the sink, if one is set and the query is sampled
+#if RPP_SEARCH_STATS
+	void reportSearchStats(const SearchStats& stats);
+#else
+	inline void reportSearchStats(const SearchStats&) {}
+#endif
+}
@@ -0,0 +1,217 @@
+#include "RobotTiledMap.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+
+namespace RPP
+{
+    namespace
+    {
+        // Bytes of one tile in the file: occupancy, clearance, checksum, padding
+        std::uint64_t tileFileBytes(int tileSize) {
+            const std::uint64_t cells = static_cast<std::uint64_t>(tileSize) * tileSize;
+            const std::uint64_t bytes = cells / 8 + cells * sizeof(std::int32_t) + sizeof(std::uint64_t);
+            return (bytes + MAP_FILE_ALIGNMENT - 1) / MAP_FILE_ALIGNMENT * MAP_FILE_ALIGNMENT;
+        }
+
+        int log2Exact(int value) {
+            int shift = 0;
+            while ((1 << shift) < value) {
+                ++shift;
+            }
+            return (1 << shift) == value ? shift : -1;
+        }
+    }
+
+    TiledMap::TiledMap(const std::string& filename, size_t cacheTiles)
+        :
+        file_(filename, std::ios::binary),
+        filename_(filename),
+        numRows_(0),
+        numCols_(0),
+        tileSize_(0),
+        tileShift_(0),
+        tileCols_(0),
+        tileBytes_(0),
+        distanceMetric_(DistanceMetric::Euclidean),
+        cacheTiles_(cacheTiles < 1 ? 1 : cacheTiles),
+        tiles_(),
+        index_(),
+        lastTile_(nullptr),
+        tileLoads_(0)
+    {
+        if (!isLittleEndianHost()) {
+            throw std::runtime_error("Tiled map files need a little-endian host");
+        }
+        if (!file_.is_open()) {
+            throw std::runtime_error("Unable to open file: " + filename);
+        }
+
+        TiledMapHeader header;
+        if (!file_.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            throw std::runtime_error("Tiled map file is truncated: " + filename);
+        }
+        if (std::memcmp(header.magic, TILED_MAP_FILE_MAGIC, sizeof(header.magic)) != 0) {
+            throw std::runtime_error("Not a tiled map file: " + filename);
+        }
+        if (header.version != TILED_MAP_FILE_VERSION || header.headerSize != sizeof(TiledMapHeader)) {
+            throw std::runtime_error("Unsupported tiled map file version " + std::to_string(header.version) + ": " + filename);
+        }
+
+        const std::uint64_t expected = header.checksum;
+        header.checksum = 0;
+        MapFileChecksum checksum;
+        checksum.update(&header, sizeof(header));
+        if (checksum.finish() != expected) {
+            throw std::runtime_error("Tiled map file checksum mismatch: " + filename);
+        }
+
+        // The header alone says where every tile is, nothing else is read until a query needs it
+        tileShift_ = log2Exact(header.tileSize);
+        if (header.numRows <= 0 || header.numCols <= 0 || header.tileSize < 8 || header.tileSize > 4096 || tileShift_ < 0 ||
+            header.tileRows != (header.numRows + header.tileSize - 1) / header.tileSize ||
+            header.tileCols != (header.numCols + header.tileSize - 1) / header.tileSize ||
+            header.tileBytes != tileFileBytes(header.tileSize) ||
+            header.fileSize != sizeof(TiledMapHeader) + static_cast<std::uint64_t>(header.tileRows) * header.tileCols * header.tileBytes ||
+            (header.distanceMetric != static_cast<std::uint32_t>(DistanceMetric::Chessboard) &&
+             header.distanceMetric != static_cast<std::uint32_t>(DistanceMetric::Euclidean))) {
+            throw std::runtime_error("Tiled map file header is corrupt: " + filename);
+        }
+        numRows_ = header.numRows;
+        numCols_ = header.numCols;
+        tileSize_ = header.tileSize;
+        tileCols_ = header.tileCols;
+        tileBytes_ = header.tileBytes;
+        distanceMetric_ = static_cast<DistanceMetric>(header.distanceMetric);
+    }
+
+    const TiledMap::Tile& TiledMap::fetch(int index) const {
+        std::unordered_map<int, std::list<Tile>::iterator>::iterator found = index_.find(index);
+        if (found != index_.end()) {
+            tiles_.splice(tiles_.begin(), tiles_, found->second);
+            lastTile_ = &tiles_.front();
+            return tiles_.front();
+        }
+
+        // Reuse the buffers of the least recently used tile once the cache is full
+        if (tiles_.size() >= cacheTiles_) {
+            index_.erase(tiles_.back().index);
+            tiles_.splice(tiles_.begin(), tiles_, std::prev(tiles_.end()));
+        }
+        else {
+            tiles_.push_front(Tile());
+        }
+        Tile& tile = tiles_.front();
+        tile.index = index;
+        lastTile_ = nullptr;
+        read(tile);
+
+        index_[index] = tiles_.begin();
+        lastTile_ = &tile;
+        return tile;
+    }
+
+    void TiledMap::read(Tile& tile) const {
+        const size_t cells = static_cast<size_t>(tileSize_) * tileSize_;
+        tile.occupancy.resize(cells / 64);
+        tile.clearance.resize(cells);
+
+        std::uint64_t stored = 0;
+        file_.clear();
+        file_.seekg(static_cast<std::streamoff>(sizeof(TiledMapHeader) + static_cast<std::uint64_t>(tile.index) * tileBytes_));
+        file_.read(reinterpret_cast<char*>(tile.occupancy.data()), static_cast<std::streamsize>(tile.occupancy.size() * sizeof(std::uint64_t)));
+        file_.read(reinterpret_cast<char*>(tile.clearance.data()), static_cast<std::streamsize>(tile.clearance.size() * sizeof(int)));
+        file_.read(reinterpret_cast<char*>(&stored), sizeof(stored));
+        if (!file_) {
+            // Leave nothing behind that a later query could mistake for the tile
+            const int index = tile.index;
+            tile.index = -1;
+            throw std::runtime_error("Failed to read tile " + std::to_string(index) + " of " + filename_);
+        }
+
+        MapFileChecksum checksum;
+        checksum.update(tile.occupancy.data(), tile.occupancy.size() * sizeof(std::uint64_t));
+        checksum.update(tile.clearance.data(), tile.clearance.size() * sizeof(int));
+        if (checksum.finish() != stored) {
+            const int index = tile.index;
+            tile.index = -1;
+            throw std::runtime_error("Tile " + std::to_string(index) + " of " + filename_ + " fails its checksum");
+        }
+        ++tileLoads_;
+    }
+
+    void TiledMap::write(const Map& map, const std::string& filename, int tileSize) {
+        if (tileSize < 8 || tileSize > 4096 || log2Exact(tileSize) < 0) {
+            throw std::invalid_argument("Tile size must be a power of two from 8 to 4096");
+        }
+        if (!isLittleEndianHost()) {
+            throw std::runtime_error("Tiled map files need a little-endian host");
+        }
+
+        TiledMapHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, TILED_MAP_FILE_MAGIC, sizeof(header.magic));
+        header.version = TILED_MAP_FILE_VERSION;
+        header.headerSize = sizeof(TiledMapHeader);
+        header.numRows = map.getNumRows();
+        header.numCols = map.getNumCols();
+        header.tileSize = tileSize;
+        header.distanceMetric = static_cast<std::uint32_t>(map.getDistanceMetric());
+        header.tileRows = (map.getNumRows() + tileSize - 1) / tileSize;
+        header.tileCols = (map.getNumCols() + tileSize - 1) / tileSize;
+        header.tileBytes = tileFileBytes(tileSize);
+        header.fileSize = sizeof(TiledMapHeader) + static_cast<std::uint64_t>(header.tileRows) * header.tileCols * header.tileBytes;
+        MapFileChecksum headerChecksum;
+        headerChecksum.update(&header, sizeof(header));
+        header.checksum = headerChecksum.finish();
+
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::invalid_argument("Unable to open file: " + filename);
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        const size_t cells = static_cast<size_t>(tileSize) * tileSize;
+        std::vector<std::uint64_t> occupancy(cells / 64);
+        std::vector<int> clearance(cells);
+        const std::vector<char> padding(static_cast<size_t>(header.tileBytes - cells / 8 - cells * sizeof(int) - sizeof(std::uint64_t)), 0);
+
+        for (int tileRow = 0; tileRow < header.tileRows; ++tileRow) {
+            for (int tileCol = 0; tileCol < header.tileCols; ++tileCol) {
+                std::fill(occupancy.begin(), occupancy.end(), ~std::uint64_t(0));
+                std::fill(clearance.begin(), clearance.end(), 0);
+                const int firstRow = tileRow * tileSize;
+                const int firstCol = tileCol * tileSize;
+                const int rows = std::min(tileSize, map.getNumRows() - firstRow);
+                const int cols = std::min(tileSize, map.getNumCols() - firstCol);
+                for (int row = 0; row < rows; ++row) {
+                    for (int col = 0; col < cols; ++col) {
+                        const int cell = map.getIndex(firstRow + row, firstCol + col);
+                        const int local = row * tileSize + col;
+                        if (!map.isObstacle(cell)) {
+                            occupancy[local >> 6] &= ~(std::uint64_t(1) << (local & 63));
+                        }
+                        clearance[local] = map.getDistanceSquared(cell);
+                    }
+                }
+
+                MapFileChecksum checksum;
+                checksum.update(occupancy.data(), occupancy.size() * sizeof(std::uint64_t));
+                checksum.update(clearance.data(), clearance.size() * sizeof(int));
+                const std::uint64_t sum = checksum.finish();
+                file.write(reinterpret_cast<const char*>(occupancy.data()), static_cast<std::streamsize>(occupancy.size() * sizeof(std::uint64_t)));
+                file.write(reinterpret_cast<const char*>(clearance.data()), static_cast<std::streamsize>(clearance.size() * sizeof(int)));
+                file.write(reinterpret_cast<const char*>(&sum), sizeof(sum));
+                file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+            }
+        }
+
+        file.close();
+        if (!file) {
+            throw std::runtime_error("Failed to write tiled map file: " + filename);
+        }
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "RobotMap.h"
+
+namespace RPP
+{
+    // Tiled map file, little-endian throughout:
+    //
+    //   header        TiledMapHeader, 128 bytes
+    //   tiles         tileRows * tileCols tiles of tileBytes each, row-major
+    //
+    // A tile covers tileSize * tileSize cells. It holds their occupancy bits in 64-bit words,
+    // then their 32-bit squared clearance, both row-major within the tile, then a checksum of
+    // the two, zero padded to a 64-byte boundary. Cells of edge tiles that fall off the map are
+    // obstacles with no clearance. Clearance is measured over the whole map, so tiles need no
+    // neighbors to answer queries near their borders.
+    const std::uint32_t TILED_MAP_FILE_VERSION = 1;
+
+    struct TiledMapHeader {
+        char magic[8];                  // TILED_MAP_FILE_MAGIC
+        std::uint32_t version;          // TILED_MAP_FILE_VERSION
+        std::uint32_t headerSize;       // sizeof(TiledMapHeader)
+        std::int32_t numRows;
+        std::int32_t numCols;
+        std::int32_t tileSize;          // Power of two
+        std::uint32_t distanceMetric;   // DistanceMetric the clearance was computed with
+        std::int32_t tileRows;
+        std::int32_t tileCols;
+        std::uint64_t tileBytes;
+        std::uint64_t fileSize;
+        std::uint64_t checksum;         // Of the header, with this field taken as zero
+        std::uint8_t reserved[64];      // Zero
+    };
+
+    static_assert(sizeof(TiledMapHeader) == 128, "Tiled map file header must stay 128 bytes");
+
+    const char TILED_MAP_FILE_MAGIC[8] = { '\x89', 'R', 'P', 'T', '\r', '\n', '\x1A', '\n' };
+
+    // Read-only map backed by a tiled map file, for maps too large to hold in memory.
+    // Opening reads the header only. Tiles are read on first use and kept in a least
+    // recently used cache of a fixed number of tiles, so memory stays bounded whatever
+    // the size of the map. Cells are addressed by row and column and counted in 64 bits.
+    // Queries page tiles in and out, so a TiledMap serves one thread at a time; open the
+    // file once per thread to search concurrently. Read errors and tiles failing their
+    // checksum throw std::runtime_error.
+    class TiledMap {
+
+        public:
+
+            // Opens the file, keeping at most cacheTiles tiles in memory
+            explicit TiledMap(const std::string& filename, size_t cacheTiles = 64);
+
+            TiledMap(const TiledMap&) = delete;
+            TiledMap& operator=(const TiledMap&) = delete;
+
+            // Getters
+            int getNumRows() const { return numRows_; }
+            int getNumCols() const { return numCols_; }
+            std::int64_t getNumCells() const { return static_cast<std::int64_t>(numRows_) * numCols_; }
+            int getTileSize() const { return tileSize_; }
+            DistanceMetric getDistanceMetric() const { return distanceMetric_; }
+            bool isInside(int row, int col) const { return row >= 0 && col >= 0 && row < numRows_ && col < numCols_; }
+            // Tiles held right now and tiles read from the file since opening
+            size_t getCachedTiles() const { return index_.size(); }
+            size_t getTileLoads() const { return tileLoads_; }
+
+            // Cell queries, the cell must be on the map
+            bool isObstacle(int row, int col) const {
+                const Tile& tile = tileAt(row, col);
+                const int local = localIndex(row, col);
+                return (tile.occupancy[local >> 6] >> (local & 63)) & 1;
+            }
+            // Squared clearance, INT_MAX when there are no obstacles
+            int getDistanceSquared(int row, int col) const { return tileAt(row, col).clearance[localIndex(row, col)]; }
+            // Same test as Map::robotFits()
+            bool robotFits(int row, int col, int robotRadius) const {
+                return row - robotRadius >= 0 && col - robotRadius >= 0 &&
+                    row + robotRadius < numRows_ && col + robotRadius < numCols_ &&
+                    getDistanceSquared(row, col) > robotRadius * robotRadius;
+            }
+
+            // Writes the map as a tiled map file, tileSize must be a power of two from 8 to 4096.
+            // A map loaded with Map::loadBinary() is read through its mapping, so the source only
+            // needs to fit in the address space, not in memory.
+            static void write(const Map& map, const std::string& filename, int tileSize = 256);
+
+        private:
+
+            struct Tile {
+                int index;                          // Tile number, row-major
+                std::vector<std::uint64_t> occupancy;
+                std::vector<int> clearance;
+            };
+
+            mutable std::ifstream file_;
+            std::string filename_;
+            int numRows_;
+            int numCols_;
+            int tileSize_;
+            int tileShift_;                         // log2 of tileSize_
+            int tileCols_;
+            std::uint64_t tileBytes_;
+            DistanceMetric distanceMetric_;
+            size_t cacheTiles_;
+            // Most recently used tile first
+            mutable std::list<Tile> tiles_;
+            mutable std::unordered_map<int, std::list<Tile>::iterator> index_;
+            mutable const Tile* lastTile_;          // Shortcut for runs of queries on one tile
+            mutable size_t tileLoads_;
+
+            int localIndex(int row, int col) const { return ((row & (tileSize_ - 1)) << tileShift_) | (col & (tileSize_ - 1)); }
+            const Tile& tileAt(int row, int col) const {
+                const int index = (row >> tileShift_) * tileCols_ + (col >> tileShift_);
+                return lastTile_ != nullptr && lastTile_->index == index ? *lastTile_ : fetch(index);
+            }
+            // Finds the tile in the cache or reads it, evicting the least recently used one
+            const Tile& fetch(int index) const;
+            void read(Tile& tile) const;
+
+    };
+}
@@ -0,0 +1,160 @@
+#include "RobotTiledPlanner.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+
+namespace RPP
+{
+	int TiledPlanner::nodeOf(std::int64_t cell, double heuristic) {
+		std::unordered_map<std::int64_t, int>::iterator found = ids_.find(cell);
+		if (found != ids_.end()) {
+			return found->second;
+		}
+
+		const int id = static_cast<int>(nodes_.size());
+		const SearchNode* before = nodes_.data();
+		nodes_.push_back(SearchNode());
+		nodes_.back().gScore = std::numeric_limits<double>::infinity();
+		nodes_.back().heuristic = heuristic;
+		cells_.push_back(cell);
+		ids_.emplace(cell, id);
+
+		// The open set reads keys and slots straight from the nodes, follow them when they move
+		if (nodes_.data() != before) {
+			openSet_.setLess(OpenSetLess(nodes_.data(), openSetTieBreak_));
+			openSet_.setSlot(OpenSetSlot(nodes_.data()));
+		}
+		return id;
+	}
+
+	PlanResult TiledPlanner::plan(const Node& startNode, const Node& goalNode, const PlanParams& params) {
+
+		PlanResult result;
+		if (!map_.isInside(startNode.getRow(), startNode.getCol())) {
+			result.status = PlanStatus::InvalidStart;
+			finishSearchStats(result);
+			return result;
+		}
+		if (!map_.isInside(goalNode.getRow(), goalNode.getCol())) {
+			result.status = PlanStatus::InvalidGoal;
+			finishSearchStats(result);
+			return result;
+		}
+		// The robot has to fit on both ends, as with the Planner
+		if (!map_.robotFits(startNode.getRow(), startNode.getCol(), params.robotRadius)) {
+			result.status = PlanStatus::InvalidStart;
+			finishSearchStats(result);
+			return result;
+		}
+		if (!map_.robotFits(goalNode.getRow(), goalNode.getCol(), params.robotRadius)) {
+			result.status = PlanStatus::InvalidGoal;
+			finishSearchStats(result);
+			return result;
+		}
+
+		const std::chrono::steady_clock::time_point searchStart = std::chrono::steady_clock::now();
+		const bool limited = params.timeLimitMilliseconds > 0.0;
+		const std::chrono::steady_clock::time_point deadline = searchStart +
+			std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(limited ? params.timeLimitMilliseconds : 0.0));
+		const double weight = std::max(params.weight, 1.0);
+		const int radius = params.robotRadius;
+		const int goalRow = goalNode.getRow();
+		const int goalCol = goalNode.getCol();
+		const std::int64_t numCols = map_.getNumCols();
+		const std::int64_t goalCell = goalRow * numCols + goalCol;
+		result.suboptimality = weight;
+
+		const HeuristicMode mode = params.heuristicMode;
+		auto estimate = [&](int row, int col) {
+			const int dRow = std::abs(row - goalRow);
+			const int dCol = std::abs(col - goalCol);
+			switch (mode) {
+			case HeuristicMode::Euclidean:
+				return std::sqrt(static_cast<double>(dRow) * dRow + static_cast<double>(dCol) * dCol);
+			case HeuristicMode::None:
+				return 0.0;
+			default:
+				return dRow < dCol ? (dCol - dRow) + NEIGHBOR_COST[0] * dRow : (dRow - dCol) + NEIGHBOR_COST[0] * dCol;
+			}
+		};
+
+		// Nothing is kept from the last query
+		openSet_.clear();
+		nodes_.clear();
+		cells_.clear();
+		ids_.clear();
+		openSetTieBreak_ = params.tieBreak;
+		openSet_.setLess(OpenSetLess(nodes_.data(), openSetTieBreak_));
+		openSet_.setSlot(OpenSetSlot(nodes_.data()));
+
+		const int start = nodeOf(startNode.getRow() * numCols + startNode.getCol(), estimate(startNode.getRow(), startNode.getCol()));
+		nodes_[start].gScore = 0.0;
+		nodes_[start].f = weight * nodes_[start].heuristic;
+		nodes_[start].state = SearchState::Open;
+		openSet_.push(start);
+		RPP_STATS(result.stats.generated = 1, result.stats.peakOpenSize = 1);
+
+		while (!openSet_.empty()) {
+
+			if ((params.expansionLimit > 0 && result.expansions >= params.expansionLimit) ||
+				(limited && (result.expansions & 255) == 0 && std::chrono::steady_clock::now() >= deadline)) {
+				result.status = PlanStatus::TimedOut;
+				break;
+			}
+
+			const int current = openSet_.pop();
+			nodes_[current].state = SearchState::Closed;
+			++result.expansions;
+
+			if (cells_[current] == goalCell) {
+				result.status = PlanStatus::Found;
+				result.cost = nodes_[current].gScore;
+				for (int node = current; node != -1; node = nodes_[node].parent) {
+					result.path.push_back(Node(static_cast<int>(cells_[node] / numCols), static_cast<int>(cells_[node] % numCols)));
+				}
+				std::reverse(result.path.begin(), result.path.end());
+				break;
+			}
+
+			const int row = static_cast<int>(cells_[current] / numCols);
+			const int col = static_cast<int>(cells_[current] % numCols);
+			for (int direction = 0; direction < 8; ++direction) {
+
+				const int nextRow = row + NEIGHBOR_ROW[direction];
+				const int nextCol = col + NEIGHBOR_COL[direction];
+				if (!map_.isInside(nextRow, nextCol) || !map_.robotFits(nextRow, nextCol, radius)) {
+					continue;
+				}
+
+				const int neighbor = nodeOf(nextRow * numCols + nextCol, estimate(nextRow, nextCol));
+				SearchNode& next = nodes_[neighbor];
+				if (next.state == SearchState::Closed) {
+					continue;
+				}
+
+				const double tentativeGScore = nodes_[current].gScore + NEIGHBOR_COST[direction];
+				if (tentativeGScore < next.gScore) {
+					next.gScore = tentativeGScore;
+					next.f = tentativeGScore + weight * next.heuristic;
+					next.parent = current;
+					if (next.state == SearchState::Open) {
+						openSet_.decreaseKey(neighbor);
+						RPP_STATS(++result.stats.decreaseKeys);
+					}
+					else {
+						next.state = SearchState::Open;
+						openSet_.push(neighbor);
+						RPP_STATS(++result.stats.generated, result.stats.peakOpenSize = std::max(result.stats.peakOpenSize, openSet_.size()));
+					}
+				}
+			}
+		}
+
+		result.searchMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - searchStart).count();
+		finishSearchStats(result);
+		return result;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <unordered_map>
+#include "RobotPlanner.h"
+#include "RobotTiledMap.h"
+
+
+namespace RPP
+{
+	// A* over a TiledMap, for maps too large for a Map and a SearchContext. Search state is
+	// kept per reached cell in a hash table instead of per map cell, so memory follows the area
+	// searched rather than the size of the map, and the map pages in only the tiles the
+	// search walks over. Takes the robot radius, tie breaking, weight and both budgets from
+	// PlanParams. The search always runs A*, and a Dijkstra heuristic, which would need the
+	// whole map up front, is replaced by the octile distance. Failures come back through
+	// PlanResult; only a tile that can not be read throws, as the TiledMap does.
+	class TiledPlanner
+	{
+	public:
+
+		TiledPlanner(const TiledMap& map)
+			:
+			map_(map),
+			nodes_(),
+			cells_(),
+			ids_(),
+			openSet_(),
+			openSetTieBreak_(TieBreak::LargerG)
+		{}
+
+		PlanResult plan(const Node& start, const Node& goal, const PlanParams& params);
+
+		const TiledMap& getMap() const { return map_; }
+
+	private:
+		const TiledMap& map_;
+		std::vector<SearchNode> nodes_;						// Reached cells in the order they were reached
+		std::vector<std::int64_t> cells_;					// Cell of each node, row-major
+		std::unordered_map<std::int64_t, int> ids_;			// Node of each reached cell
+		OpenSet openSet_;									// Of node numbers
+		TieBreak openSetTieBreak_;
+
+		// Node of the cell, added unvisited when the cell was not reached yet
+		int nodeOf(std::int64_t cell, double heuristic);
+
+	};
+}